@@ -4,6 +4,266 @@
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <type_traits>
+
+///////////////////////////Open set policies/////////////////////
+//Policy for the open list of AIAStar/AIAStarGraph, nodes are referred by their index in chart.
+//Nodes with equal f are popped in the order they were (re)inserted, same as std::multimap
+//did originally, so any policy gives identical paths and keeps lockstep CRC unchanged.
+/*
+class OpenSet
+{
+	void Init(uint32_t size);//Max amount of nodes, called once
+	void clear();
+	bool empty();
+	void push(uint32_t index, TypeH f);//Node is not in set
+	void update(uint32_t index, TypeH f);//Node is in set, reinsert with new f
+	uint32_t pop();//Remove and return node with lowest f
+};
+*/
+
+//Reference policy, allocates a node per push
+template<class TypeH>
+class AIAStarMultimapSet
+{
+public:
+	typedef std::multimap<TypeH, uint32_t> type_map;
+
+	void Init(uint32_t size) { self_it.resize(size); }
+	void clear() { open_map.clear(); }
+	bool empty() const { return open_map.empty(); }
+
+	void push(uint32_t index, TypeH f) {
+		self_it[index] = open_map.insert(typename type_map::value_type(f, index));
+	}
+
+	void update(uint32_t index, TypeH f) {
+		open_map.erase(self_it[index]);
+		push(index, f);
+	}
+
+	uint32_t pop() {
+		typename type_map::iterator low = open_map.begin();
+		uint32_t index = low->second;
+		open_map.erase(low);
+		return index;
+	}
+
+protected:
+	type_map open_map;
+	std::vector<typename type_map::iterator> self_it;
+};
+
+//Indexed binary heap with decrease-key, no allocations after Init
+//Ties are broken by insertion sequence number
+template<class TypeH>
+class AIAStarHeapSet
+{
+public:
+	enum { NOT_IN_HEAP = 0xFFFFFFFF };
+
+	void Init(uint32_t size) {
+		heap.reserve(size);
+		heap_pos.assign(size, NOT_IN_HEAP);
+		clear();
+	}
+
+	void clear() {
+		for (const Entry& e : heap) {
+			heap_pos[e.index] = NOT_IN_HEAP;
+		}
+		heap.clear();
+		sequence = 0;
+	}
+
+	bool empty() const { return heap.empty(); }
+
+	void push(uint32_t index, TypeH f) {
+		xassert(heap_pos[index] == NOT_IN_HEAP);
+		Entry e = { f, sequence++, index };
+		heap.push_back(e);
+		heap_pos[index] = heap.size() - 1;
+		siftUp(heap.size() - 1);
+	}
+
+	void update(uint32_t index, TypeH f) {
+		uint32_t pos = heap_pos[index];
+		xassert(pos != NOT_IN_HEAP);
+		Entry& e = heap[pos];
+		e.f = f;
+		e.seq = sequence++;
+		//Fresh sequence can only push node further back among its equals
+		siftDown(siftUp(pos));
+	}
+
+	uint32_t pop() {
+		uint32_t index = heap.front().index;
+		heap_pos[index] = NOT_IN_HEAP;
+		if (heap.size() > 1) {
+			place(0, heap.back());
+			heap.pop_back();
+			siftDown(0);
+		} else {
+			heap.pop_back();
+		}
+		return index;
+	}
+
+protected:
+	struct Entry
+	{
+		TypeH f;
+		uint32_t seq;
+		uint32_t index;
+	};
+
+	std::vector<Entry> heap;
+	std::vector<uint32_t> heap_pos;//Position in heap for each node
+	uint32_t sequence;
+
+	static inline bool less(const Entry& a, const Entry& b) {
+		if (a.f < b.f) return true;
+		if (b.f < a.f) return false;
+		return a.seq < b.seq;
+	}
+
+	inline void place(uint32_t pos, const Entry& e) {
+		heap[pos] = e;
+		heap_pos[e.index] = pos;
+	}
+
+	uint32_t siftUp(uint32_t pos) {
+		Entry e = heap[pos];
+		while (pos > 0) {
+			uint32_t parent = (pos - 1) >> 1;
+			if (!less(e, heap[parent])) break;
+			place(pos, heap[parent]);
+			pos = parent;
+		}
+		place(pos, e);
+		return pos;
+	}
+
+	uint32_t siftDown(uint32_t pos) {
+		Entry e = heap[pos];
+		uint32_t size = heap.size();
+		for (;;) {
+			uint32_t child = pos * 2 + 1;
+			if (child >= size) break;
+			if (child + 1 < size && less(heap[child + 1], heap[child])) child++;
+			if (!less(heap[child], e)) break;
+			place(pos, heap[child]);
+			pos = child;
+		}
+		place(pos, e);
+		return pos;
+	}
+};
+
+//Bucket queue for integer costs, one FIFO bucket per f value relative to lowest seen f
+//Updates are lazy: stale entries are skipped on pop by comparing sequence numbers
+template<class TypeH>
+class AIAStarBucketSet
+{
+public:
+	static_assert(std::is_integral<TypeH>::value, "AIAStarBucketSet requires integer costs");
+
+	void Init(uint32_t size) {
+		node_seq.resize(size);
+		buckets.clear();
+		clear();
+	}
+
+	void clear() {
+		for (Bucket& b : buckets) {
+			b.entries.clear();
+			b.head = 0;
+		}
+		base = 0;
+		cursor = 0;
+		count = 0;
+		sequence = 0;
+	}
+
+	bool empty() const { return count == 0; }
+
+	void push(uint32_t index, TypeH f) {
+		count++;
+		insert(index, f);
+	}
+
+	void update(uint32_t index, TypeH f) {
+		//Previous entry becomes stale since node_seq changes
+		insert(index, f);
+	}
+
+	uint32_t pop() {
+		xassert(count);
+		for (;;) {
+			xassert(cursor < buckets.size());
+			Bucket& b = buckets[cursor];
+			while (b.head < b.entries.size()) {
+				const Entry& e = b.entries[b.head++];
+				if (node_seq[e.index] == e.seq) {
+					node_seq[e.index] = STALE;
+					count--;
+					return e.index;
+				}
+			}
+			b.entries.clear();
+			b.head = 0;
+			cursor++;
+		}
+	}
+
+protected:
+	enum { STALE = 0xFFFFFFFF };
+
+	struct Entry
+	{
+		uint32_t index;
+		uint32_t seq;
+	};
+
+	struct Bucket
+	{
+		std::vector<Entry> entries;
+		uint32_t head = 0;
+	};
+
+	std::vector<Bucket> buckets;
+	std::vector<uint32_t> node_seq;//Sequence of the live entry of each node
+	TypeH base;//f of buckets[0]
+	uint32_t cursor;//No live entries below this bucket
+	uint32_t count;//Live entries
+	uint32_t sequence;
+
+	void insert(uint32_t index, TypeH f) {
+		if (count == 1 && sequence == 0) {
+			//First push since clear, anchor buckets here
+			base = f;
+			cursor = 0;
+		} else if (f < base) {
+			//Inconsistent heuristic can go below the anchor, shift buckets up
+			uint32_t shift = static_cast<uint32_t>(base - f);
+			size_t old_size = buckets.size();
+			buckets.resize(old_size + shift);
+			std::rotate(buckets.begin(), buckets.begin() + old_size, buckets.end());
+			base = f;
+			cursor += shift;
+		}
+		uint32_t slot = static_cast<uint32_t>(f - base);
+		if (buckets.size() <= slot) {
+			buckets.resize(slot + 1);
+		}
+		if (slot < cursor) {
+			cursor = slot;
+		}
+		node_seq[index] = sequence;
+		Entry e = { index, sequence++ };
+		buckets[slot].entries.push_back(e);
+	}
+};
 
 ///////////////////////////AIAStar/////////////////////
 //AIAStar::FindPath поиск пути из точки from 
@@ -20,22 +280,10 @@ class Heuristic
 };
 */
 
-#define FAST_ERASE 0
-//FAST_ERASE==0 Меньше данных - больше действий
-//FAST_ERASE!=0 Больше данных - меньше действий
-//Но реально разницы почти нет
-
-template<class Heuristic,class TypeH=float>
+template<class Heuristic,class TypeH=float,class OpenSet=AIAStarHeapSet<TypeH> >
 class AIAStar
 {
 public:
-#if FAST_ERASE
-  struct OnePoint;
-  typedef std::multimap<TypeH, OnePoint*> type_point_map;
-#else
-  typedef std::multimap<TypeH,sPoint> type_point_map;
-#endif
-
 	struct OnePoint
 	{
 		TypeH g;//Затраты на продвижение до этой точки
@@ -44,17 +292,12 @@ public:
 		OnePoint* parent;
 		bool is_open;
 
-#if FAST_ERASE
-		POINT pt;
-		type_point_map::iterator self_it;
-#endif
-
 		inline TypeH f(){return g+h;}
 	};
 protected:
 	int dx,dy;
 	OnePoint* chart;
-	type_point_map open_map;
+	OpenSet open_set;
 
 	uint32_t is_used_num;//Если is_used_num==used, то ячейка используется
 
@@ -76,37 +319,34 @@ protected:
 	void clear();
 	inline sPoint PosBy(OnePoint* p)
 	{
-#if FAST_ERASE
-		return p->pt;
-#else
 		int offset=p-chart;
 		sPoint pos;
 		pos.x=offset%dx;
 		pos.y=offset/dx;
 		return pos;
-#endif
 	}
 };
 
-template<class Heuristic,class TypeH>
-AIAStar<Heuristic,TypeH>::AIAStar()
+template<class Heuristic,class TypeH,class OpenSet>
+AIAStar<Heuristic,TypeH,OpenSet>::AIAStar()
 {
 	chart=NULL;
 	heuristic=NULL;
 }
 
-template<class Heuristic,class TypeH>
-void AIAStar<Heuristic,TypeH>::Init(int _dx,int _dy)
+template<class Heuristic,class TypeH,class OpenSet>
+void AIAStar<Heuristic,TypeH,OpenSet>::Init(int _dx,int _dy)
 {
 	dx=_dx;dy=_dy;
 
 	int size=dx*dy;
 	chart=new OnePoint[size];
+	open_set.Init(size);
 	clear();
 }
 
-template<class Heuristic,class TypeH>
-void AIAStar<Heuristic,TypeH>::clear()
+template<class Heuristic,class TypeH,class OpenSet>
+void AIAStar<Heuristic,TypeH,OpenSet>::clear()
 {
 	int size=dx*dy;
 	is_used_num=0;
@@ -114,20 +354,20 @@ void AIAStar<Heuristic,TypeH>::clear()
 		chart[i].used=0;
 }
 
-template<class Heuristic,class TypeH>
-AIAStar<Heuristic,TypeH>::~AIAStar()
+template<class Heuristic,class TypeH,class OpenSet>
+AIAStar<Heuristic,TypeH,OpenSet>::~AIAStar()
 {
 	delete[] chart;
 }
 
-template<class Heuristic,class TypeH>
-bool AIAStar<Heuristic,TypeH>::FindPath(sPoint from, Heuristic* hr, std::vector<sPoint>& path)
+template<class Heuristic,class TypeH,class OpenSet>
+bool AIAStar<Heuristic,TypeH,OpenSet>::FindPath(sPoint from, Heuristic* hr, std::vector<sPoint>& path)
 {
 	num_point_examine=0;
 	num_find_erase=0;
 
 	is_used_num++;
-	open_map.clear();
+	open_set.clear();
 	path.clear();
 	if(is_used_num==0)
 		clear();//Для того, чтобы вызвалась эта строчка, необходимо гиганское время
@@ -141,31 +381,19 @@ bool AIAStar<Heuristic,TypeH>::FindPath(sPoint from, Heuristic* hr, std::vector<
 	p->is_open=true;
 	p->parent=NULL;
 
-#if FAST_ERASE
-	p->pt = from;
-	p->self_it = open_map.insert(typename type_point_map::value_type(p->f(),p));
-#else
-	open_map.insert(typename type_point_map::value_type(p->f(),from));
-#endif
+	open_set.push(p-chart,p->f());
 
 	const int size_child=8;
 	const int sx[size_child]={-1,+1,+1,-1, 0,-1, 0,+1};
 	const int sy[size_child]={-1,-1,+1,+1,-1, 0,+1, 0};
 
 
-	while(!open_map.empty())
+	while(!open_set.empty())
 	{
-		typename type_point_map::iterator low=open_map.begin();
-#if FAST_ERASE
-		OnePoint* parent=low->second;
-		POINT pt = parent->pt;
-#else
-		sPoint pt=(*low).second;
-		OnePoint* parent=chart+pt.y*dx+pt.x;
-#endif
+		OnePoint* parent=chart+open_set.pop();
+		sPoint pt=PosBy(parent);
 
 		parent->is_open=false;
-		open_map.erase(low);
 
 		if(heuristic->IsEndPoint(pt.x,pt.y))
 		{
@@ -209,49 +437,18 @@ bool AIAStar<Heuristic,TypeH>::FindPath(sPoint from, Heuristic* hr, std::vector<
 				if(!p->is_open)continue;
 				if(p->g<=newg)continue;
 
-#if FAST_ERASE
-				open_map.erase(p->self_it);
-#else
-				//Удаляем элемент из open_map
-				TypeH f=p->f();
-				typename type_point_map::iterator cur=open_map.find(p->f());
-				bool erase=false;
-				while(cur!=open_map.end())
-				{
-					if((*cur).first!=f)break;
-					if((*cur).second.x==child.x && (*cur).second.y==child.y)
-					{
-						open_map.erase(cur);
-						erase=true;
-						break;
-					}
-					num_find_erase++;
-					cur++;
-				}
+				p->parent=parent;
+				p->g=newg;
+				p->h=heuristic->GetH(child.x,child.y);
+				open_set.update(p-chart,p->f());
 				num_find_erase++;
-				//xassert(erase);
-				if(!erase)continue;
-#endif
+				continue;
 			}
 
 			p->parent=parent;
-/*
-			{
-				POINT pp=PosBy(parent);
-				POINT pc=PosBy(p);
-				xassert(abs(pc.x-pp.x)<=1 && 
-						abs(pc.y-pp.y)<=1);
-			}
-*/
 			p->g=newg;
 			p->h=heuristic->GetH(child.x,child.y);
-
-#if FAST_ERASE
-			p->pt = child;
-			p->self_it = open_map.insert(typename type_point_map::value_type(p->f(),p));
-#else
-			open_map.insert(typename type_point_map::value_type(p->f(),child));
-#endif
+			open_set.push(p-chart,p->f());
 			p->is_open=true;
 			p->used=is_used_num;
 		}
@@ -260,8 +457,8 @@ bool AIAStar<Heuristic,TypeH>::FindPath(sPoint from, Heuristic* hr, std::vector<
 	return false;
 }
 
-template<class Heuristic,class TypeH>
-void AIAStar<Heuristic,TypeH>::GetStatistic(
+template<class Heuristic,class TypeH,class OpenSet>
+void AIAStar<Heuristic,TypeH,OpenSet>::GetStatistic(
 		int* p_num_point_examine,int* p_num_find_erase)
 {
 	if(p_num_point_examine)
@@ -291,13 +488,10 @@ class Heuristic
 };
 */
 
-template<class Heuristic,class Node,class TypeH=float>
+template<class Heuristic,class Node,class TypeH=float,class OpenSet=AIAStarHeapSet<TypeH> >
 class AIAStarGraph
 {
 public:
-	struct OnePoint;
-	typedef std::multimap<TypeH, OnePoint*> type_point_map;
-
 	struct OnePoint
 	{
 		TypeH g;//Затраты на продвижение до этой точки
@@ -307,13 +501,12 @@ public:
 		bool is_open;
 
 		Node* node;
-		typename type_point_map::iterator self_it;
 
 		inline TypeH f(){return g+h;}
 	};
 protected:
 	std::vector<OnePoint> chart;
-	type_point_map open_map;
+	OpenSet open_set;
 
 	uint32_t is_used_num;//Если is_used_num==used, то ячейка используется
 
@@ -331,7 +524,7 @@ public:
 	void GetStatistic(int* num_point_examine,int* num_find_erase);
 
 	//Debug
-	OnePoint* GetInternalBuffer(){return chart;};
+	OnePoint* GetInternalBuffer(){return &chart[0];};
 	uint32_t GetUsedNum(){return is_used_num;}
 protected:
 	void clear();
@@ -339,19 +532,24 @@ protected:
 	{
 		return p->node;
 	}
+	inline uint32_t IndexBy(OnePoint* p)
+	{
+		return p-&chart[0];
+	}
 };
 
-template<class Heuristic,class Node,class TypeH>
-AIAStarGraph<Heuristic,Node,TypeH>::AIAStarGraph()
+template<class Heuristic,class Node,class TypeH,class OpenSet>
+AIAStarGraph<Heuristic,Node,TypeH,OpenSet>::AIAStarGraph()
 {
 	heuristic=NULL;
 }
 
-template<class Heuristic,class Node,class TypeH>
-void AIAStarGraph<Heuristic,Node,TypeH>::Init(std::vector<Node>& all_node)
+template<class Heuristic,class Node,class TypeH,class OpenSet>
+void AIAStarGraph<Heuristic,Node,TypeH,OpenSet>::Init(std::vector<Node>& all_node)
 {
 	int size=all_node.size();
 	chart.resize(size);
+	open_set.Init(size);
 
 	for(int i=0;i<size;i++)
 	{
@@ -362,8 +560,8 @@ void AIAStarGraph<Heuristic,Node,TypeH>::Init(std::vector<Node>& all_node)
 	clear();
 }
 
-template<class Heuristic,class Node,class TypeH>
-void AIAStarGraph<Heuristic,Node,TypeH>::clear()
+template<class Heuristic,class Node,class TypeH,class OpenSet>
+void AIAStarGraph<Heuristic,Node,TypeH,OpenSet>::clear()
 {
 	is_used_num=0;
 	typename std::vector<OnePoint>::iterator it;
@@ -371,14 +569,14 @@ void AIAStarGraph<Heuristic,Node,TypeH>::clear()
 		it->used=0;
 }
 
-template<class Heuristic,class Node,class TypeH>
-bool AIAStarGraph<Heuristic,Node,TypeH>::FindPath(Node* from,Heuristic* hr, std::vector<Node*>& path)
+template<class Heuristic,class Node,class TypeH,class OpenSet>
+bool AIAStarGraph<Heuristic,Node,TypeH,OpenSet>::FindPath(Node* from,Heuristic* hr, std::vector<Node*>& path)
 {
 	num_point_examine=0;
 	num_find_erase=0;
 
 	is_used_num++;
-	open_map.clear();
+	open_set.clear();
 	path.clear();
 	if(is_used_num==0)
 		clear();//Для того, чтобы вызвалась эта строчка, необходимо гиганское время
@@ -392,17 +590,14 @@ bool AIAStarGraph<Heuristic,Node,TypeH>::FindPath(Node* from,Heuristic* hr, std:
 	p->is_open=true;
 	p->parent=NULL;
 
-	p->self_it = open_map.insert(typename type_point_map::value_type(p->f(),p));
+	open_set.push(IndexBy(p),p->f());
 
-	while(!open_map.empty())
+	while(!open_set.empty())
 	{
-		typename type_point_map::iterator low=open_map.begin();
-
-		OnePoint* parent=low->second;
+		OnePoint* parent=&chart[open_set.pop()];
 		Node* node = parent->node;
 
 		parent->is_open=false;
-		open_map.erase(low);
 
 		if(heuristic->IsEndPoint(node))
 		{
@@ -437,15 +632,19 @@ bool AIAStarGraph<Heuristic,Node,TypeH>::FindPath(Node* from,Heuristic* hr, std:
 				if(!p->is_open)continue;
 				if(p->g<=newg)continue;
 
-				open_map.erase(p->self_it);
+				p->parent=parent;
+				p->g=newg;
+				p->h=heuristic->GetH(cur_node);
+				open_set.update(IndexBy(p),p->f());
 				num_find_erase++;
+				continue;
 			}
 
 			p->parent=parent;
 			p->g=newg;
 			p->h=heuristic->GetH(cur_node);
 
-			p->self_it = open_map.insert(typename type_point_map::value_type(p->f(),p));
+			open_set.push(IndexBy(p),p->f());
 
 			p->is_open=true;
 			p->used=is_used_num;
@@ -455,8 +654,8 @@ bool AIAStarGraph<Heuristic,Node,TypeH>::FindPath(Node* from,Heuristic* hr, std:
 	return false;
 }
 
-template<class Heuristic,class Node,class TypeH>
-void AIAStarGraph<Heuristic,Node,TypeH>::GetStatistic(
+template<class Heuristic,class Node,class TypeH,class OpenSet>
+void AIAStarGraph<Heuristic,Node,TypeH,OpenSet>::GetStatistic(
 		int* p_num_point_examine,int* p_num_find_erase)
 {
 	if(p_num_point_examine)
@@ -6,43 +6,162 @@
 #include "AIPrm.h"
 #include "Runtime.h"
 
-bool AITile::update(int x,int y)
+#include <SDL_cpuinfo.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AITILE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AITILE_NEON
+#include <arm_neon.h>
+#endif
+
+////////////////////////////////////////////////////////
+//			AITile
+////////////////////////////////////////////////////////
+// Статистика по тайлу в целых числах, все ядра обязаны давать одинаковый результат
+struct AITileStat
 {
-	bool prev_log = completed();
-	
-	height_min = 255;
-	int height_max = 0;
-	dig_work = 0;
-	dig_less = false;
-
-	int height_avr = 0;
-	int hZeroPlast = vMap.hZeroPlast;
-	for(int yy = 0;yy < tile_size;yy++)
-	{
-		int offset = vMap.offsetGBuf(x*tile_size, y*tile_size + yy);
-		unsigned char* h_buffer = vMap.GVBuf + offset;
-		unsigned short* attr_buffer = vMap.GABuf + offset;
+	int height_sum;
+	int height_min;
+	int height_max;
+	int dig_work;
+	bool dig_less;
+};
+
+typedef void (*AITileKernel)(const unsigned char* h_buffer, const unsigned short* attr_buffer, int stride, int hZeroPlast, AITileStat& stat);
+
+static void tileStatScalar(const unsigned char* h_buffer, const unsigned short* attr_buffer, int stride, int hZeroPlast, AITileStat& stat)
+{
+	stat.height_sum = 0;
+	stat.height_min = 255;
+	stat.height_max = 0;
+	stat.dig_work = 0;
+	stat.dig_less = false;
 
-		for(int xx = 0;xx < tile_size;xx++)
+	for(int yy = 0;yy < AITile::tile_size;yy++, h_buffer += stride, attr_buffer += stride)
+	{
+		for(int xx = 0;xx < AITile::tile_size;xx++)
 		{
 			unsigned char h = h_buffer[xx];
-			height_avr += h;
+			stat.height_sum += h;
 			unsigned short attr = attr_buffer[xx];
 			
 			if(!GRIDTST_TALLER_HZEROPLAST(attr) || (attr & GRIDAT_MASK_HARDNESS) == GRIDAT_MASK_HARDNESS)
-				dig_work += xm::abs(h_buffer[xx] - hZeroPlast);
+				stat.dig_work += xm::abs(h - hZeroPlast);
 			else
-				dig_less = true;
+				stat.dig_less = true;
 
-			if(height_min > h)
-				height_min = h;
-			if(height_max < h)
-				height_max = h;
+			if(stat.height_min > h)
+				stat.height_min = h;
+			if(stat.height_max < h)
+				stat.height_max = h;
 		}
 	}
+}
+
+// Векторные ядра рассчитаны на тайл 4x4: 16 высот в одном регистре
+#ifdef AITILE_SSE2
+static void tileStatSSE2(const unsigned char* h_buffer, const unsigned short* attr_buffer, int stride, int hZeroPlast, AITileStat& stat)
+{
+	int rows[4];
+	for(int i = 0; i < 4; i++)
+		memcpy(&rows[i], h_buffer + i*stride, 4);
+	__m128i h = _mm_setr_epi32(rows[0], rows[1], rows[2], rows[3]);
+
+	__m128i a01 = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(attr_buffer)),
+									 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(attr_buffer + stride)));
+	__m128i a23 = _mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(attr_buffer + 2*stride)),
+									 _mm_loadl_epi64(reinterpret_cast<const __m128i*>(attr_buffer + 3*stride)));
+
+	// Копается: не выше зеропласта или максимальная твердость
+	__m128i zero = _mm_setzero_si128();
+	__m128i taller = _mm_set1_epi16(GRIDAT_TALLER_HZEROPLAST);
+	__m128i hardness = _mm_set1_epi16(GRIDAT_MASK_HARDNESS);
+	__m128i dig01 = _mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(a01, taller), zero), _mm_cmpeq_epi16(_mm_and_si128(a01, hardness), hardness));
+	__m128i dig23 = _mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(a23, taller), zero), _mm_cmpeq_epi16(_mm_and_si128(a23, hardness), hardness));
+	__m128i dig = _mm_packs_epi16(dig01, dig23);
+
+	__m128i z = _mm_set1_epi8(static_cast<char>(hZeroPlast));
+	__m128i diff = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(h, z), _mm_subs_epu8(z, h)), dig);
+
+	__m128i sum = _mm_sad_epu8(h, zero);
+	stat.height_sum = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+	__m128i work = _mm_sad_epu8(diff, zero);
+	stat.dig_work = _mm_cvtsi128_si32(work) + _mm_cvtsi128_si32(_mm_srli_si128(work, 8));
+	stat.dig_less = _mm_movemask_epi8(dig) != 0xFFFF;
+
+	__m128i hmin = _mm_min_epu8(h, _mm_srli_si128(h, 8));
+	__m128i hmax = _mm_max_epu8(h, _mm_srli_si128(h, 8));
+	hmin = _mm_min_epu8(hmin, _mm_srli_si128(hmin, 4));
+	hmax = _mm_max_epu8(hmax, _mm_srli_si128(hmax, 4));
+	hmin = _mm_min_epu8(hmin, _mm_srli_si128(hmin, 2));
+	hmax = _mm_max_epu8(hmax, _mm_srli_si128(hmax, 2));
+	hmin = _mm_min_epu8(hmin, _mm_srli_si128(hmin, 1));
+	hmax = _mm_max_epu8(hmax, _mm_srli_si128(hmax, 1));
+	stat.height_min = _mm_cvtsi128_si32(hmin) & 0xFF;
+	stat.height_max = _mm_cvtsi128_si32(hmax) & 0xFF;
+}
+#endif
+
+#ifdef AITILE_NEON
+static void tileStatNEON(const unsigned char* h_buffer, const unsigned short* attr_buffer, int stride, int hZeroPlast, AITileStat& stat)
+{
+	uint32_t rows[4];
+	for(int i = 0; i < 4; i++)
+		memcpy(&rows[i], h_buffer + i*stride, 4);
+	uint8x16_t h = vreinterpretq_u8_u32(vld1q_u32(rows));
+
+	uint16x8_t a01 = vcombine_u16(vld1_u16(attr_buffer), vld1_u16(attr_buffer + stride));
+	uint16x8_t a23 = vcombine_u16(vld1_u16(attr_buffer + 2*stride), vld1_u16(attr_buffer + 3*stride));
+
+	// Копается: не выше зеропласта или максимальная твердость
+	uint16x8_t taller = vdupq_n_u16(GRIDAT_TALLER_HZEROPLAST);
+	uint16x8_t hardness = vdupq_n_u16(GRIDAT_MASK_HARDNESS);
+	uint16x8_t dig01 = vorrq_u16(vceqzq_u16(vandq_u16(a01, taller)), vceqq_u16(vandq_u16(a01, hardness), hardness));
+	uint16x8_t dig23 = vorrq_u16(vceqzq_u16(vandq_u16(a23, taller)), vceqq_u16(vandq_u16(a23, hardness), hardness));
+	uint8x16_t dig = vcombine_u8(vmovn_u16(dig01), vmovn_u16(dig23));
+
+	uint8x16_t diff = vandq_u8(vabdq_u8(h, vdupq_n_u8(static_cast<uint8_t>(hZeroPlast))), dig);
+
+	stat.height_sum = vaddlvq_u8(h);
+	stat.dig_work = vaddlvq_u8(diff);
+	stat.dig_less = vminvq_u8(dig) == 0;
+	stat.height_min = vminvq_u8(h);
+	stat.height_max = vmaxvq_u8(h);
+}
+#endif
+
+static AITileKernel selectTileKernel()
+{
+	// ai_tile_scalar - для сверки векторных ядер со скалярным
+	if(AITile::tile_size == 4 && !check_command_line("ai_tile_scalar")){
+#if defined(AITILE_SSE2)
+		if(SDL_HasSSE2())
+			return tileStatSSE2;
+#elif defined(AITILE_NEON)
+		if(SDL_HasNEON())
+			return tileStatNEON;
+#endif
+	}
+	return tileStatScalar;
+}
+
+bool AITile::update(int x,int y)
+{
+	static const AITileKernel kernel = selectTileKernel();
+
+	bool prev_log = completed();
+
+	int offset = vMap.offsetGBuf(x*tile_size, y*tile_size);
+	AITileStat stat;
+	kernel(vMap.GVBuf + offset, vMap.GABuf + offset, vMap.GH_SIZE, vMap.hZeroPlast, stat);
 
-	height = height_avr/tile_area;
-	delta_height = height_max - height_min;
+	height_min = stat.height_min;
+	dig_work = stat.dig_work;
+	dig_less = stat.dig_less;
+	height = stat.height_sum/tile_area;
+	delta_height = stat.height_max - stat.height_min;
 
 	return completed() && prev_log != completed();
 }
@@ -56,7 +175,6 @@ AITileMap::AITileMap(int hsize,int vsize)
 	pWalkMap=NULL;
 
 	path_finder = new ClusterFind(sizeX(), sizeY(), terrainPathFind.clusterSize);
-	path_finder2 = new ClusterFind(sizeX(), sizeY(), terrainPathFind.clusterSize);
 	path_hard_map = new ClusterFind(sizeX(), sizeY(), terrainPathFind.clusterSize);
 
 	InitialUpdate(); 
@@ -65,7 +183,6 @@ AITileMap::~AITileMap()
 {
 	RELEASE(pWalkMap);
 	delete path_finder;
-	delete path_finder2;
 	delete path_hard_map;
 }
 
@@ -78,9 +195,6 @@ void AITileMap::InitialUpdate()
 	rebuildWalkMap(path_finder->GetWalkMap());
 	path_finder->Set(terrainPathFind.enableSmoothing);
 
-	memcpy(path_finder2->GetWalkMap(),path_finder->GetWalkMap(),sizeX()*sizeY()*sizeof(path_finder2->GetWalkMap()[0]));
-	path_finder2->SetLater(&terrainPathFind);
-
 	updateHardMap();
 }
 
@@ -100,6 +214,23 @@ void AITileMap::UpdateRect(int x1,int y1,int dx,int dy)
 			FOR_EACH(call_back,it)
 				(*it)->changeTileState(x,y);
 		}
+
+	//Кластеры перестраиваются в recalcPathFind
+	if(!terrainPathFind.levelOfDetail){
+		//Клетка зависит и от тайлов справа и снизу, а справа от конца строки - начало следующей
+		if(x1 <= 0)
+			x2 = sizeX() - 1;
+		x1--;
+		y1--;
+	}
+	x1 = std::max(x1, 0);
+	y1 = std::max(y1, 0);
+	x2 = std::min(x2, sizeX() - 1);
+	y2 = std::min(y2, sizeY() - 1);
+	if(x1 <= x2 && y1 <= y2){
+		rebuildWalkMap(path_finder->GetRawWalkMap(), x1, y1, x2, y2);
+		path_finder->MarkDirty(x1, y1, x2, y2);
+	}
 }
 
 void AITileMap::placeBuilding(const Vect2i& v1, const Vect2i& size, bool place)
@@ -250,47 +381,33 @@ bool AITileMap::findPath(const Vect2i& from_w, const Vect2i& to_w, std::vector<V
 	return b;
 }
 
-void AITileMap::rebuildWalkMap(uint8_t* walk_map)
+void AITileMap::rebuildWalkMap(uint8_t* walk_map, int x1, int y1, int x2, int y2)
 {
-	int size = sizeY()*sizeX();
-	memset(walk_map,0,size);
-	for(int i = 0;i < size;i++) {
-		if(map()[i].height_min) {
-/*
-			int dh = map()[i].delta_height;
-			if(dh >= terrainPathFind.maxColor)
-				dh = terrainPathFind.levelOfDetail;
-			else {
-				dh = dh*terrainPathFind.levelOfDetail/terrainPathFind.maxColor;
-				if(dh >= terrainPathFind.levelOfDetail-2)
-					dh = terrainPathFind.levelOfDetail;
-			}
-
-			xassert(dh <= terrainPathFind.maxColor);
-
-			if(dh < terrainPathFind.minimizeMinLevel)
-				dh = 0;
-/*/
-			int dh=0;//Не учитывать гористость поверхности 
-/**/
-			if(!walk_map[i])
-				walk_map[i] = dh;
-			if(dh==terrainPathFind.levelOfDetail)
-			{
-				if(i-1>=0)
-					walk_map[i-1]=dh;
-				if(i+1<size)
-					walk_map[i+1]=dh;
-				if(i-sizeX()>=0)
-					walk_map[i-sizeX()]=dh;
-				if(i+sizeX()<size)
-					walk_map[i+sizeX()]=dh;
-			}
+	//dh всегда 0, поэтому при ненулевом levelOfDetail соседи не трогаются
+	//и клетка зависит только от своего тайла - выбор без ветвлений по строкам
+	if(terrainPathFind.levelOfDetail){
+		for(int y = y1; y <= y2; y++){
+			const AITile* tile = map() + y*sizeX();
+			uint8_t* walk = walk_map + y*sizeX();
+			for(int x = x1; x <= x2; x++)
+				walk[x] = tile[x].height_min ? 0 : ClusterHeuristicDitch::heuristic_ditch;
 		}
-		else 
-			walk_map[i] = ClusterHeuristicDitch::heuristic_ditch;
+		return;
+	}
+
+	//dh == levelOfDetail == 0: проходимый тайл обнуляет и соседей, поэтому клетка рва остаётся
+	//рвом, только если тайлы справа и снизу, которые полный обход проходит позже, тоже ров
+	int size = sizeY()*sizeX();
+	for(int y = y1; y <= y2; y++)
+	for(int i = y*sizeX() + x1; i <= y*sizeX() + x2; i++) {
+		bool walk = map()[i].height_min || (i + 1 < size && map()[i + 1].height_min) || (i + sizeX() < size && map()[i + sizeX()].height_min);
+		walk_map[i] = walk ? 0 : ClusterHeuristicDitch::heuristic_ditch;
 	}
+}
 
+void AITileMap::rebuildWalkMap(uint8_t* walk_map)
+{
+	rebuildWalkMap(walk_map, 0, 0, sizeX() - 1, sizeY() - 1);
 
 	//Добавить кластер
 	if(0 && field_dispatcher)
@@ -359,11 +476,9 @@ void AITileMap::recalcPathFind()
 {
 	start_timer_auto(calcPathMap,STATISTICS_GROUP_TOTAL);
 
-	if(path_finder2->SetLaterQuant()){
-		std::swap(path_finder2,path_finder);
-
-		rebuildWalkMap(path_finder2->GetWalkMap());
-		path_finder2->SetLater(&terrainPathFind);
+	if(path_finder->UpdateDirty(terrainPathFind.enableSmoothing)){
+		if(terrainPathFind.showMap==1)
+			updateWalkMap(path_finder->GetWalkMap());
 	}
 }
 
@@ -404,7 +519,8 @@ void AITileMap::drawWalkMap()
 	char str[256];
 	cFont* pFont=gb_VisGeneric->CreateDebugFont();
 	terRenderDevice->SetFont(pFont);
-	sprintf(str,"cluster=%i",path_finder->GetNumCluster());
+	sprintf(str,"cluster=%i cache hit=%i miss=%i",path_finder->GetNumCluster(),
+		path_finder->GetPathCacheHits(),path_finder->GetPathCacheMisses());
 	terRenderDevice->OutText(0,288,str,sColor4f(1,1,1,1));
 
 	terRenderDevice->SetFont(NULL);
@@ -57,10 +57,10 @@ public:
 protected:
 	std::list<class AIPlayer*> call_back;
 	ClusterFind* path_finder;
-	ClusterFind* path_finder2;
 	ClusterFind* path_hard_map;
 
 	void rebuildWalkMap(uint8_t* walk_map);
+	void rebuildWalkMap(uint8_t* walk_map, int x1, int y1, int x2, int y2); // map coords, inclusive
 
 	cTexture* pWalkMap;
 	void updateWalkMap(uint8_t* walk_map);
@@ -34,6 +34,8 @@ const DWORD next_limits[size_child]={
 };
 */
 
+uint32_t ClusterFind::path_cache_kinds = 0;
+
 ClusterFind::ClusterFind(int _dx,int _dy,int _max_distance)
 {
 	dx=_dx;dy=_dy;
@@ -44,6 +46,7 @@ ClusterFind::ClusterFind(int _dx,int _dy,int _max_distance)
 	size_one=size_two=0;
 
 	walk_map=new uint8_t[dx * dy];
+	raw_walk_map=new uint8_t[dx * dy];
 
 	is_used_size=dx*dy;
 	is_used=new uint8_t[is_used_size];
@@ -56,6 +59,12 @@ ClusterFind::ClusterFind(int _dx,int _dy,int _max_distance)
 
 	quant_of_build=0;
 	cur_quant_build=0;
+
+	rebuild_tag=0;
+	rebuild_keep=0xFFFFFFFFu;
+
+	path_cache_hits=0;
+	path_cache_misses=0;
 }
 
 ClusterFind::~ClusterFind()
@@ -67,14 +76,19 @@ ClusterFind::~ClusterFind()
 
 	delete[] is_used;
 	delete[] walk_map;
+	delete[] raw_walk_map;
 }
 
 void ClusterFind::Set(bool enable_smooting)
 {
+	memcpy(raw_walk_map,walk_map,dx*dy*sizeof(walk_map[0]));
+	dirty_rects.clear();
+
 	if(enable_smooting)
 		Smooting();
 
 	memset(pmap,0,dx*dy*sizeof(pmap[0]));
+	ClearPathCache();
 
 	//Переделать, при превышении предела всё рухнет
 	all_cluster.clear();
@@ -172,7 +186,7 @@ void ClusterFind::ClusterOne(int x,int y,int id,Cluster& c)
 	size_one=1;
 
 	int num_point=1;
-	pmap[y*dx+x]=id;
+	pmap[y*dx+x]=id|rebuild_tag;
 	uint8_t weq=walk_map[y * dx + x];
 
 	c.x=x;c.y=y;
@@ -204,22 +218,23 @@ void ClusterFind::ClusterOne(int x,int y,int id,Cluster& c)
                 uint32_t & pd=pmap[addp];
 				uint8_t w=walk_map[addp];
 
-				if(pd!=0)
+				uint32_t owner=Owner(pd);
+				if(owner!=0)
 				{
-					Cluster& ct=all_cluster[pd-1];
+					Cluster& ct=all_cluster[owner-1];
 
 					if(ct.temp_set)
 					{
 
-						xassert(pd<all_cluster.size());
+						xassert(owner<all_cluster.size());
 						ct.temp_set=false;
-						vtemp_set.push_back(pd-1);
+						vtemp_set.push_back(owner-1);
 					}
 				}else
 				{
 					if(w==weq && size_two<max_cell_in_front)
 					{
-						pd=id;
+						pd=id|rebuild_tag;
 						c.xcenter+=xx;
 						c.ycenter+=yy;
 						num_point++;
@@ -998,11 +1013,15 @@ void ClusterFind::SetLater(ClusterFindPrm* prm)
 
 	cur_quant_build=0;
 
+	memcpy(raw_walk_map,walk_map,dx*dy*sizeof(walk_map[0]));
+	dirty_rects.clear();
+
 	if (prm->enableSmoothing) {
         Smooting();
     }
 
 	memset(pmap,0,dx*dy*sizeof(pmap[0]));
+	ClearPathCache();
 
 	all_cluster.clear();
 	all_cluster.reserve(max_cluster_size);
@@ -1019,6 +1038,11 @@ void ClusterFind::SetLater(ClusterFindPrm* prm)
 	set_later_cur_num=1;
 }
 
+void ClusterFind::ClearPathCache()
+{
+	path_cache.clear();
+}
+
 bool ClusterFind::SetLaterQuant()
 {
 	if(ready())
@@ -1052,6 +1076,305 @@ bool ClusterFind::SetLaterQuant()
 	return end;
 }
 
+void ClusterFind::MarkDirty(int x1,int y1,int x2,int y2)
+{
+	x1=max(x1,0);
+	y1=max(y1,0);
+	x2=min(x2,dx-1);
+	y2=min(y2,dy-1);
+	if(x1>x2 || y1>y2)
+		return;
+
+	//Пересекающиеся и соседние прямоугольники объединяются
+	Rect r={x1,y1,x2,y2};
+	std::vector<Rect>::iterator it=dirty_rects.begin();
+	while(it!=dirty_rects.end())
+	{
+		if(it->x1<=r.x2+1 && r.x1<=it->x2+1 && it->y1<=r.y2+1 && r.y1<=it->y2+1)
+		{
+			r.x1=min(r.x1,it->x1);
+			r.y1=min(r.y1,it->y1);
+			r.x2=max(r.x2,it->x2);
+			r.y2=max(r.y2,it->y2);
+			dirty_rects.erase(it);
+			it=dirty_rects.begin();
+		}
+		else
+			++it;
+	}
+	dirty_rects.push_back(r);
+}
+
+bool ClusterFind::UpdateDirty(bool enable_smooting)
+{
+	if(dirty_rects.empty() || !ready())
+		return false;
+
+	changed_rects.clear();
+	std::vector<Rect>::iterator it;
+	FOR_EACH(dirty_rects,it)
+		UpdateSmooting(*it,enable_smooting);
+	dirty_rects.clear();
+
+	if(changed_rects.empty())
+		return false;
+
+	Recluster();
+	Relink();
+	ClearPathCache();
+	return true;
+}
+
+void ClusterFind::UpdateSmooting(const Rect& dirty,bool enable_smooting)
+{
+	//Smooting идёт по строкам на месте: клетка зависит от своего значения и от соседей
+	//справа и снизу до сглаживания, слева и сверху - после. Пересчитываются клетки,
+	//у которых изменился хоть один вход, изменения расходятся вправо и вниз.
+	Rect changed={dx,dy,-1,-1};
+	int prev_lo=dx,prev_hi=-1;//Изменившиеся клетки предыдущей строки
+	for(int y=max(dirty.y1-1,0);y<dy;y++)
+	{
+		int lo=prev_lo,hi=prev_hi;
+		if(y<=dirty.y2)
+		{
+			lo=min(lo,max(dirty.x1-1,0));
+			hi=max(hi,dirty.x2);
+		}
+		if(lo>hi)
+			break;
+
+		uint8_t* p=walk_map+y*dx;
+		const uint8_t* r=raw_walk_map+y*dx;
+		bool smooth_row=enable_smooting && y>0 && y<dy-1;
+		int cur_lo=dx,cur_hi=-1;
+		bool left_changed=false;
+		for(int x=lo;x<dx;x++)
+		{
+			if(x>hi && !left_changed)
+				break;
+
+			uint8_t v=r[x];
+			if(smooth_row && x>0 && x<dx-1)
+			{
+				int b=r[x];
+				int up,down,center;
+				up=down=center=0;
+
+				int cur;
+				cur=p[x-1];
+				if(cur==b)center++;
+				else if(cur<b)down++;
+				else up++;
+
+				cur=r[x+1];
+				if(cur==b)center++;
+				else if(cur<b)down++;
+				else up++;
+
+				cur=p[x-dx];
+				if(cur==b)center++;
+				else if(cur<b)down++;
+				else up++;
+
+				cur=r[x+dx];
+				if(cur==b)center++;
+				else if(cur<b)down++;
+				else up++;
+
+				if(center==0 && (up>0 || down>0))
+				{
+					if(up>down)
+						v=b+1;
+					else
+						v=b-1;
+				}
+			}
+
+			left_changed=p[x]!=v;
+			if(left_changed)
+			{
+				p[x]=v;
+				cur_lo=min(cur_lo,x);
+				cur_hi=x;
+			}
+		}
+
+		if(cur_lo<=cur_hi)
+		{
+			changed.x1=min(changed.x1,cur_lo);
+			changed.x2=max(changed.x2,cur_hi);
+			changed.y1=min(changed.y1,y);
+			changed.y2=y;
+		}
+		prev_lo=cur_lo;
+		prev_hi=cur_hi;
+	}
+
+	if(changed.x1<=changed.x2)
+		changed_rects.push_back(changed);
+}
+
+void ClusterFind::Recluster()
+{
+	//ClusterOne не заходит дальше reach от затравки. Кластеры до первого, у которого
+	//затравка ближе reach к изменениям, не меняются. Дальше они строятся заново тем же
+	//проходом по строкам и сверяются со старыми: когда изменения остались выше и занятые
+	//клетки совпадают, остальные старые кластеры получились бы такими же, и они
+	//вклеиваются со сдвигом номеров.
+	const int reach=max_distance+1;
+	std::sort(changed_rects.begin(),changed_rects.end(),[](const Rect& r0,const Rect& r1){ return r0.y1<r1.y1; });
+
+	size_t next_rect=0;
+	while(next_rect<changed_rects.size())
+	{
+		uint32_t keep=all_cluster.size();
+		for(uint32_t i=1;i<all_cluster.size() && keep==all_cluster.size();i++)
+		{
+			Cluster& c=all_cluster[i];
+			for(size_t r=next_rect;r<changed_rects.size();r++)
+			{
+				const Rect& rc=changed_rects[r];
+				if(c.x>=rc.x1-reach && c.x<=rc.x2+reach && c.y>=rc.y1-reach && c.y<=rc.y2+reach)
+				{
+					keep=i;
+					break;
+				}
+			}
+		}
+		xassert(keep<all_cluster.size());
+
+		int start=all_cluster[keep].y*dx+all_cluster[keep].x;
+		int row_start=all_cluster[keep].y*dx;
+		prev_pmap.resize(dx*dy);
+		memcpy(&prev_pmap[row_start],pmap+row_start,(dx*dy-row_start)*sizeof(pmap[0]));
+
+		prev_cluster.clear();
+		prev_cluster.insert(prev_cluster.end(),std::make_move_iterator(all_cluster.begin()+keep),std::make_move_iterator(all_cluster.end()));
+		all_cluster.resize(keep);
+
+		//Связи с более поздними кластерами стоят в конце index_link по возрастанию
+		kept_links.clear();
+		for(uint32_t i=1;i<keep;i++)
+		{
+			std::vector<uint32_t>& link=all_cluster[i].index_link;
+			size_t n=link.size();
+			while(n>0 && link[n-1]>=keep)
+				n--;
+			for(size_t j=n;j<link.size();j++)
+				kept_links.push_back(std::make_pair(i,link[j]));
+			link.resize(n);
+		}
+
+		rebuild_tag=rebuild_tag_bit;
+		rebuild_keep=keep;
+
+		uint32_t prev=keep;//Старый кластер, с затравкой которого сравнивается текущая
+		uint32_t prev_end=keep+prev_cluster.size();
+		int need_y=0;//Пока затравка выше, новые кластеры видят изменения
+		bool converged=false;
+		int y=0;
+		for(int pos=start;pos<dx*dy;pos++)
+		{
+			if(Owner(pmap[pos]))
+				continue;
+
+			int x=pos%dx;
+			y=pos/dx;
+			while(next_rect<changed_rects.size() && changed_rects[next_rect].y1-reach<=y)
+				need_y=max(need_y,changed_rects[next_rect++].y2+2);
+
+			if(y>=need_y)
+			{
+				while(prev<prev_end && prev_cluster[prev-keep].y*dx+prev_cluster[prev-keep].x<pos)
+					prev++;
+				if(prev<prev_end && prev_cluster[prev-keep].y*dx+prev_cluster[prev-keep].x==pos &&
+					RebuildConverged(y,keep,prev,int(all_cluster.size())-int(prev)))
+				{
+					converged=true;
+					break;
+				}
+			}
+
+			uint32_t num=all_cluster.size();
+			all_cluster.resize(num+1);
+			ClusterOne(x,y,num+1,all_cluster[num]);
+		}
+
+		int delta=int(all_cluster.size())-int(prev);
+		int end=dx*dy;
+		if(converged)
+		{
+			//Связи, которые добавили бы более поздние кластеры
+			for(uint32_t i=keep;i<prev;i++)
+			{
+				std::vector<uint32_t>& link=prev_cluster[i-keep].index_link;
+				std::vector<uint32_t>::iterator il;
+				FOR_EACH(link,il)
+					if(*il>=prev)
+					{
+						xassert(int(i)+delta>=int(keep) && int(i)+delta<int(all_cluster.size()));
+						all_cluster[i+delta].index_link.push_back(*il+delta);
+					}
+			}
+
+			std::vector<std::pair<uint32_t,uint32_t> >::iterator ik;
+			FOR_EACH(kept_links,ik)
+				if(ik->second>=prev)
+					all_cluster[ik->first].index_link.push_back(ik->second+delta);
+
+			for(uint32_t i=prev;i<prev_end;i++)
+			{
+				Cluster& c=prev_cluster[i-keep];
+				c.self_id+=delta;
+				std::vector<uint32_t>::iterator il;
+				FOR_EACH(c.index_link,il)
+					if(*il>=keep)
+						*il+=delta;
+				all_cluster.push_back(std::move(c));
+			}
+
+			if(!delta)
+				end=min(y+max_distance+1,dy)*dx;
+		}
+
+		for(int i=start;i<end;i++)
+		{
+			uint32_t& p=pmap[i];
+			if(p & rebuild_tag)
+				p^=rebuild_tag;
+			else if(p>keep)
+			{
+				xassert(converged && p>prev);
+				p+=delta;
+			}
+		}
+
+		rebuild_tag=0;
+		rebuild_keep=0xFFFFFFFFu;
+	}
+}
+
+bool ClusterFind::RebuildConverged(int y,uint32_t keep,uint32_t prev,int delta)
+{
+	//Будущие кластеры занимают клетки от затравки и дальше, а смотрят на строку выше.
+	//Занятые клетки там должны совпадать со старыми на момент затравки prev.
+	int from=(y-1)*dx;
+	int to=min(y+max_distance+1,dy)*dx;
+	for(int i=from;i<to;i++)
+	{
+		uint32_t prev_id=prev_pmap[i];
+		uint32_t id=Owner(pmap[i]);
+		if(prev_id>prev)
+		{
+			if(id)
+				return false;
+		}
+		else if(id!=(prev_id<=keep ? prev_id : prev_id+delta))
+			return false;
+	}
+	return true;
+}
+
 /*
 Как проложить путь сбоку, не расстоянии примерно X.
 
@@ -44,6 +44,8 @@ public:
 
 	// Доступ к карте для заполнения перед Set/SetLater
 	uint8_t* GetWalkMap(){ return walk_map; }
+	// Несглаженная карта, изменять для MarkDirty
+	uint8_t* GetRawWalkMap(){ return raw_walk_map; }
 
 	//Создать сеть кластеров по walk_map
 	void Set(bool enable_smooting);
@@ -54,18 +56,44 @@ public:
 	bool SetLaterQuant();//true - процесс завершён
 	bool ready() const { return cur_quant_build >= quant_of_build; }
 
+	//Перестроение только изменившейся части. Кластеры строятся тем же проходом, что и в Set,
+	//начиная с первого кластера, который видит изменения, пока состояние не совпадёт
+	//с прежним - результат тот же, что и у полного Set по новой карте.
+	void MarkDirty(int x1,int y1,int x2,int y2);//Координаты карты включительно
+	bool UpdateDirty(bool enable_smooting);//true - что-то перестроено
+
+	//Путь между кластерами берётся из кэша, если уже искался с тем же типом эвристики.
+	//Эвристика не должна иметь состояния кроме end.
 	template<class ClusterHeuristic>
 	bool FindPath(const Vect2i& from, const Vect2i& to, std::vector<Vect2i>& out_path, ClusterHeuristic& heuristic)
 	{
+		start_timer_auto(ClusterFindPath, STATISTICS_GROUP_AI);
+
 		heuristic.end = getCluster(to);
+		Cluster* from_cluster = getCluster(from);
+
+		uint64_t key = PathCacheKey(PathCacheKind<ClusterHeuristic>(), from_cluster, heuristic.end);
+		PathCache::iterator ci = path_cache.find(key);
+		if(ci != path_cache.end()){
+			path_cache_hits++;
+			statistics_add(pathCacheHit, STATISTICS_GROUP_AI, 1);
+		}else{
+			path_cache_misses++;
+			statistics_add(pathCacheHit, STATISTICS_GROUP_AI, 0);
+
+			if(path_cache.size() >= max_path_cache_size)
+				path_cache.clear();
+
+			ci = path_cache.insert(PathCache::value_type(key, PathCacheEntry())).first;
+			AIAStarGraph<ClusterHeuristic,Cluster> astar;
+			astar.Init(all_cluster);
+			ci->second.found = astar.FindPath(from_cluster, &heuristic, ci->second.path);
+		}
 
-		std::vector<Cluster*> path;
-		AIAStarGraph<ClusterHeuristic,Cluster> astar;
-		astar.Init(all_cluster);
-		if(!astar.FindPath(getCluster(from), &heuristic, path))
+		if(!ci->second.found)
 			return false;
 
-		SoftPath(path, from, to, out_path);
+		SoftPath(ci->second.path, from, to, out_path);
 
 		SoftPath2(out_path, dx, dy, walk_map, heuristic);
 
@@ -104,6 +132,13 @@ public:
 	}
 
 	int GetNumCluster() { return all_cluster.size(); }
+	//Для замеров AIAStarGraph отдельно от FindPath
+	std::vector<Cluster>& GetClusters() { return all_cluster; }
+
+	//Вызывается при любом перестроении all_cluster
+	void ClearPathCache();
+	int GetPathCacheHits() const { return path_cache_hits; }
+	int GetPathCacheMisses() const { return path_cache_misses; }
 
 	inline Cluster* getCluster(const Vect2i& point)
 	{
@@ -119,6 +154,7 @@ protected:
 	int dx,dy;
 	uint32_t* pmap;
 	uint8_t* walk_map;
+	uint8_t* raw_walk_map;//walk_map до сглаживания
 
 	enum{
 		max_cell_in_front=64,
@@ -142,11 +178,65 @@ protected:
 	int cur_quant_build;
 	int set_later_cur_num;
 
+	//для UpdateDirty
+	struct Rect
+	{
+		int x1,y1,x2,y2;
+	};
+	std::vector<Rect> dirty_rects;//Изменения raw_walk_map
+	std::vector<Rect> changed_rects;//Изменения walk_map после сглаживания
+	std::vector<uint32_t> prev_pmap;//pmap до перестроения
+	std::vector<Cluster> prev_cluster;//Перестраиваемые кластеры
+	std::vector<std::pair<uint32_t,uint32_t> > kept_links;//Связи оставшихся кластеров с перестраиваемыми
+	//Во время перестроения новые номера в pmap помечаются rebuild_tag,
+	//старые номера больше rebuild_keep считаются свободными клетками
+	enum { rebuild_tag_bit = 0x80000000u };
+	uint32_t rebuild_tag;
+	uint32_t rebuild_keep;
+
+	inline uint32_t Owner(uint32_t p) const
+	{
+		if(p & rebuild_tag)
+			return p ^ rebuild_tag;
+		return p <= rebuild_keep ? p : 0;
+	}
+
+	//Кэш результатов AIAStarGraph: (тип эвристики, from, to) -> путь по кластерам
+	enum { max_path_cache_size = 4096 };
+	struct PathCacheEntry
+	{
+		bool found;
+		std::vector<Cluster*> path;
+		PathCacheEntry() : found(false) {}
+	};
+	typedef std::unordered_map<uint64_t, PathCacheEntry> PathCache;
+	PathCache path_cache;
+	int path_cache_hits;
+	int path_cache_misses;
+
+	static uint32_t path_cache_kinds;
+	template<class ClusterHeuristic>
+	static uint32_t PathCacheKind()
+	{
+		static const uint32_t kind = path_cache_kinds++;
+		return kind;
+	}
+
+	inline uint64_t PathCacheKey(uint32_t kind, Cluster* from, Cluster* to)
+	{
+		uint64_t from_index = from - &all_cluster[0];
+		uint64_t to_index = to - &all_cluster[0];
+		return (uint64_t(kind) << 48) | (from_index << 24) | to_index;
+	}
+
 
 	/////////////////////////
 	//	Private Members
 	void Relink();
 	void Smooting();
+	void UpdateSmooting(const Rect& dirty,bool enable_smooting);
+	void Recluster();
+	bool RebuildConverged(int y,uint32_t keep,uint32_t prev,int delta);
 	//Добавлять, если temp_set==true
 	std::vector<uint32_t> vtemp_set;//Для ClusterOne
 	void ClusterOne(int x,int y,int id,Cluster& c);
@@ -276,4 +366,4 @@ float HeuristicLine(int xfrom, int yfrom, int xto, int yto,
     return len;
 }
 
-#endif //__CLUSTERFIND_H__
\ No newline at end of file
+#endif //__CLUSTERFIND_H__
\ No newline at end of file
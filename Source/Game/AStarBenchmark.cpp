@@ -0,0 +1,193 @@
+#include "StdAfx.h"
+#include "Runtime.h"
+#include "Universe.h"
+#include "../HT/ht.h"
+#include "AITileMap.h"
+#include "ClusterFind.h"
+#include "AIPrm.h"
+
+// Замер вариантов открытого списка AIAStar/AIAStarGraph на карте проходимости мира:
+//	perimeter graph=headless astar_bench=<миссия или сохранение> [astar_bench_paths=2000]
+// Проходимость строится по тайлам ai_tile_map так же, как для поиска пути (ров - height_min==0),
+// по ней - сеть кластеров ClusterFind. Между случайными точками ищутся пути по клеткам (AIAStar)
+// и по кластерам (AIAStarGraph) с каждым открытым списком, пути сверяются с AIAStarMultimapSet.
+// AIAStarBucketSet работает только с целой стоимостью, поэтому есть лишь в замере по клеткам с int.
+// Код возврата 2 - пути различаются.
+
+static const int ASTAR_BENCH_DITCH = 127;//Как ClusterHeuristicDitch::heuristic_ditch
+static const int ASTAR_BENCH_DITCH_COST = 1000;
+
+//Восьмисвязная сетка, шаг 10, по диагонали 14
+template<class TypeH>
+class AStarBenchGridHeuristic
+{
+public:
+	const uint8_t* walk;
+	int dx;
+	int end_x, end_y;
+
+	inline TypeH GetH(int x, int y)
+	{
+		int ax = xm::abs(x - end_x), ay = xm::abs(y - end_y);
+		return 10*std::max(ax, ay) + 4*std::min(ax, ay);
+	}
+	inline TypeH GetG(int x1, int y1, int x2, int y2)
+	{
+		TypeH g = x1 != x2 && y1 != y2 ? 14 : 10;
+		if(walk[y2*dx + x2] == ASTAR_BENCH_DITCH)
+			g += ASTAR_BENCH_DITCH_COST;
+		return g;
+	}
+	inline bool IsEndPoint(int x, int y){ return x == end_x && y == end_y; }
+};
+
+//Та же оценка, что у ClusterHeuristicDitch
+class AStarBenchGraphHeuristic
+{
+public:
+	typedef ClusterFind::Cluster Node;
+	Node* end;
+
+	inline float GetH(Node* pos)
+	{
+		return xm::sqrt(sqr(pos->xcenter - end->xcenter) + sqr(pos->ycenter - end->ycenter));
+	}
+	inline float GetG(Node* pos1, Node* pos2)
+	{
+		if((pos2->walk & ClusterFind::DOWN_MASK) == ASTAR_BENCH_DITCH)
+			return ASTAR_BENCH_DITCH_COST;
+		float f = xm::sqrt(sqr(pos1->xcenter - pos2->xcenter) + sqr(pos1->ycenter - pos2->ycenter))*
+				  ((pos2->walk & ClusterFind::DOWN_MASK) + 1);
+		if((pos1->walk ^ pos2->walk) & ClusterFind::UP_MASK)
+			f += 1000;
+		return f;
+	}
+	inline bool IsEndPoint(Node* pos){ return pos == end; }
+};
+
+//Контрольная сумма пути, чтобы сверять варианты без хранения всех путей
+static unsigned int astar_bench_path_sum(unsigned int sum, int x, int y)
+{
+	return (sum*31 + x)*31 + y;
+}
+
+template<class TypeH, class OpenSet>
+static double astar_bench_grid(const std::vector<uint8_t>& walk, int dx, int dy, const std::vector<Vect2i>& points, std::vector<unsigned int>& sums)
+{
+	typedef AStarBenchGridHeuristic<TypeH> Heuristic;
+	AIAStar<Heuristic, TypeH, OpenSet>* astar = new AIAStar<Heuristic, TypeH, OpenSet>;
+	astar->Init(dx, dy);
+	Heuristic heuristic;
+	heuristic.walk = &walk[0];
+	heuristic.dx = dx;
+
+	std::vector<sPoint> path;
+	uint64_t begin = getPerformanceCounter();
+	for(int i = 0; i + 1 < points.size(); i += 2){
+		sPoint from = { points[i].x, points[i].y };
+		heuristic.end_x = points[i + 1].x;
+		heuristic.end_y = points[i + 1].y;
+		unsigned int sum = astar->FindPath(from, &heuristic, path);
+		std::vector<sPoint>::iterator it;
+		FOR_EACH(path, it)
+			sum = astar_bench_path_sum(sum, it->x, it->y);
+		sums.push_back(sum);
+	}
+	double ms = (getPerformanceCounter() - begin)/(getPerformanceFrequency()*1e-3);
+	delete astar;
+	return ms;
+}
+
+template<class OpenSet>
+static double astar_bench_graph(ClusterFind& clusters, const std::vector<Vect2i>& points, std::vector<unsigned int>& sums)
+{
+	typedef ClusterFind::Cluster Cluster;
+	AIAStarGraph<AStarBenchGraphHeuristic, Cluster, float, OpenSet> astar;
+	astar.Init(clusters.GetClusters());
+	Cluster* first = &clusters.GetClusters()[0];
+	AStarBenchGraphHeuristic heuristic;
+
+	std::vector<Cluster*> path;
+	uint64_t begin = getPerformanceCounter();
+	for(int i = 0; i + 1 < points.size(); i += 2){
+		heuristic.end = clusters.getCluster(points[i + 1]);
+		unsigned int sum = astar.FindPath(clusters.getCluster(points[i]), &heuristic, path);
+		std::vector<Cluster*>::iterator it;
+		FOR_EACH(path, it)
+			sum = astar_bench_path_sum(sum, *it - first, 0);
+		sums.push_back(sum);
+	}
+	return (getPerformanceCounter() - begin)/(getPerformanceFrequency()*1e-3);
+}
+
+static int astar_bench_report(const char* name, double ms, int paths, const std::vector<unsigned int>& sums, const std::vector<unsigned int>& reference)
+{
+	int differs = 0;
+	for(int i = 0; i < sums.size(); i++){
+		if(sums[i] != reference[i])
+			differs++;
+	}
+	printf("astar_bench: %-24s %9.3f ms, %7.2f us/path%s\n", name, ms, ms*1e3/paths, differs ? ", paths differ" : "");
+	if(differs)
+		fprintf(stderr, "astar_bench: %s differs from multimap in %d paths\n", name, differs);
+	return differs;
+}
+
+int astar_benchmark(const char* mission_path)
+{
+	int paths = 2000;
+	check_command_line_parameter("astar_bench_paths", paths);
+
+	MissionDescription mission(mission_path);
+	if(mission.worldID() == -1){
+		fprintf(stderr, "astar_bench: can't load %s\n", mission_path);
+		return 1;
+	}
+
+	HTManager* runtime = HTManager::instance();
+	runtime->GameStart(mission);
+	MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+
+	int dx = ai_tile_map->sizeX();
+	int dy = ai_tile_map->sizeY();
+	ClusterFind clusters(dx, dy, terrainPathFind.clusterSize);
+	uint8_t* walk_map = clusters.GetWalkMap();
+	for(int i = 0; i < dx*dy; i++)
+		walk_map[i] = ai_tile_map->map()[i].height_min ? 0 : ASTAR_BENCH_DITCH;
+	std::vector<uint8_t> walk(walk_map, walk_map + dx*dy);
+	clusters.Set(terrainPathFind.enableSmoothing);
+
+	RandomGenerator rnd;
+	std::vector<Vect2i> points;
+	for(int i = 0; i < paths*2; i++)
+		points.push_back(Vect2i(rnd(dx), rnd(dy)));
+
+	printf("astar_bench: %s, walk map %dx%d, %d clusters, %d paths\n", mission_path, dx, dy, clusters.GetNumCluster(), paths);
+
+	int differs = 0;
+	std::vector<unsigned int> reference, sums;
+	double ms = astar_bench_grid<int, AIAStarMultimapSet<int> >(walk, dx, dy, points, reference);
+	astar_bench_report("grid int multimap", ms, paths, reference, reference);
+	ms = astar_bench_grid<int, AIAStarHeapSet<int> >(walk, dx, dy, points, sums);
+	differs += astar_bench_report("grid int heap", ms, paths, sums, reference);
+	sums.clear();
+	ms = astar_bench_grid<int, AIAStarBucketSet<int> >(walk, dx, dy, points, sums);
+	differs += astar_bench_report("grid int bucket", ms, paths, sums, reference);
+
+	reference.clear();
+	sums.clear();
+	ms = astar_bench_grid<float, AIAStarMultimapSet<float> >(walk, dx, dy, points, reference);
+	astar_bench_report("grid float multimap", ms, paths, reference, reference);
+	ms = astar_bench_grid<float, AIAStarHeapSet<float> >(walk, dx, dy, points, sums);
+	differs += astar_bench_report("grid float heap", ms, paths, sums, reference);
+
+	reference.clear();
+	sums.clear();
+	ms = astar_bench_graph<AIAStarMultimapSet<float> >(clusters, points, reference);
+	astar_bench_report("clusters multimap", ms, paths, reference, reference);
+	ms = astar_bench_graph<AIAStarHeapSet<float> >(clusters, points, sums);
+	differs += astar_bench_report("clusters heap", ms, paths, sums, reference);
+
+	runtime->GameClose();
+	return differs ? 2 : 0;
+}
@@ -0,0 +1,63 @@
+#include "StdAfx.h"
+#include "Runtime.h"
+#include "../Terra/crc.h"
+
+// Замер реализаций crc32 без мира:
+//	perimeter graph=headless crc_bench=<сторона мира, 2048> [crc_bench_repeats=20]
+// Четыре буфера side*side со случайным содержимым считаются построчно, как в vrtMap::getWorldCRC
+// (геометрия, динамика, атрибуты, поверхность), каждой реализацией из crc32_variant.
+// Последняя реализация в списке - та, что выбрана для crc32. Код возврата 2 - результаты различаются.
+
+static const int CRC_BENCH_BUFFERS = 4;
+
+int crc_benchmark(const char* side_text)
+{
+	int side = atoi(side_text);
+	if(side <= 0 || side > 8192){
+		fprintf(stderr, "crc_bench: bad world side %s\n", side_text);
+		return 1;
+	}
+	int repeats = 20;
+	check_command_line_parameter("crc_bench_repeats", repeats);
+
+	RandomGenerator rnd;
+	std::vector<unsigned char> buffers[CRC_BENCH_BUFFERS];
+	for(int i = 0; i < CRC_BENCH_BUFFERS; i++){
+		buffers[i].resize(side*side);
+		std::vector<unsigned char>::iterator it;
+		FOR_EACH(buffers[i], it)
+			*it = rnd(256);
+	}
+
+	double megabytes = double(side)*side*CRC_BENCH_BUFFERS/(1024.*1024.);
+	printf("crc_bench: world %dx%d, %.1f MB per pass, %d passes\n", side, side, megabytes, repeats);
+
+	double frequency = getPerformanceFrequency()*1e-3;
+	unsigned int reference = 0;
+	int differs = 0;
+	crc32_func func;
+	const char* name;
+	for(int variant = 0; (name = crc32_variant(variant, &func)) != 0; variant++){
+		unsigned int crc = 0;
+		double best = 1e10;
+		for(int repeat = 0; repeat < repeats; repeat++){
+			uint64_t begin = getPerformanceCounter();
+			crc = startCRC32;
+			for(int y = 0; y < side; y++){
+				int offset = y*side;
+				for(int i = 0; i < CRC_BENCH_BUFFERS; i++)
+					crc = func(&buffers[i][offset], side, crc);
+			}
+			best = std::min(best, (getPerformanceCounter() - begin)/frequency);
+		}
+
+		if(!variant)
+			reference = crc;
+		bool match = crc == reference;
+		if(!match)
+			differs++;
+		printf("crc_bench: %-14s %8.3f ms, %8.1f MB/s, crc %08x%s\n", name, best, megabytes*1e3/best, crc, match ? "" : " differs");
+	}
+
+	return differs ? 2 : 0;
+}
@@ -0,0 +1,97 @@
+#include "StdAfx.h"
+#include "Umath.h"
+#include "IVisGeneric.h"
+#include "IRenderDevice.h"
+#include "RenderMT.h"
+#include "Runtime.h"
+#include "../HT/JobPool.h"
+
+// Замер расчета частиц без GPU:
+//	perimeter graph=headless effect_bench=filth,Volcano [effect_bench_copies=20] [effect_bench_frames=600] [logic_workers=N]
+// Каждый эффект из библиотек (RESOURCE\FX\<имя>.effect) ставится copies раз по сетке и зацикливается,
+// затем frames кадров считаются Animate и заполнение вершин (PrepareDraw) - то же, что делает cScene,
+// только без вывода. Рабочие потоки - из JobPool (logic_workers), без него все в одном потоке.
+
+static const float EFFECT_BENCH_FRAME_TIME = 33; //мс
+static const float EFFECT_BENCH_STEP = 64;
+
+int effect_benchmark(const char* libraries)
+{
+	MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+
+	int copies = 20;
+	int frames = 600;
+	check_command_line_parameter("effect_bench_copies", copies);
+	check_command_line_parameter("effect_bench_frames", frames);
+
+	std::vector<EffectKey*> keys;
+	std::string list = libraries;
+	size_t begin = 0;
+	while(begin <= list.size()){
+		size_t end = list.find(',', begin);
+		if(end == std::string::npos)
+			end = list.size();
+		std::string name = list.substr(begin, end - begin);
+		begin = end + 1;
+		if(name.empty())
+			continue;
+		EffectLibrary* lib = terVisGeneric->GetEffectLibrary(name.c_str(), true);
+		if(!lib){
+			fprintf(stderr, "effect_bench: can't load effect library %s\n", name.c_str());
+			return 1;
+		}
+		EffectLibrary::iterator it;
+		FOR_EACH(*lib, it)
+			keys.push_back(*it);
+	}
+	if(keys.empty()){
+		fprintf(stderr, "effect_bench: no effects\n");
+		return 1;
+	}
+
+	std::vector<cEffect*> effects;
+	int side = xm::ceil(xm::sqrt(static_cast<float>(keys.size()*copies)));
+	for(int i = 0; i < copies; i++){
+		std::vector<EffectKey*>::iterator it;
+		FOR_EACH(keys, it){
+			int index = effects.size();
+			cEffect* effect = terScene->CreateEffect(**it, nullptr);
+			effect->SetCycled(true);
+			effect->SetPosition(MatXf(Mat3f::ID, Vect3f((index%side)*EFFECT_BENCH_STEP, (index/side)*EFFECT_BENCH_STEP, 0)));
+			effects.push_back(effect);
+		}
+	}
+
+	cCamera* camera = terScene->CreateCamera();
+	float center = side*EFFECT_BENCH_STEP*0.5f;
+	camera->SetPosition(MatXf(Mat3f::ID, Vect3f(-center, -center, -center*2)));
+
+	JobPool* job_pool = JobPool::instance();
+	printf("effect_bench: %d effects (%d keys x %d), %d frames, %d workers\n",
+		   static_cast<int>(effects.size()), static_cast<int>(keys.size()), copies, frames, job_pool ? job_pool->workers() : 0);
+
+	double frequency = getPerformanceFrequency()*1e-3;
+	double animate_sum = 0, prepare_sum = 0, animate_min = 1e10, prepare_min = 1e10;
+	for(int frame = 0; frame < frames; frame++){
+		uint64_t t0 = getPerformanceCounter();
+		cEffect::AnimateParallel(effects, EFFECT_BENCH_FRAME_TIME);
+		uint64_t t1 = getPerformanceCounter();
+		cEffect::PrepareDrawParallel(effects, camera);
+		uint64_t t2 = getPerformanceCounter();
+
+		double animate = (t1 - t0)/frequency, prepare = (t2 - t1)/frequency;
+		animate_sum += animate;
+		prepare_sum += prepare;
+		animate_min = std::min(animate_min, animate);
+		prepare_min = std::min(prepare_min, prepare);
+	}
+
+	printf("effect_bench: animate %.3f ms/frame (min %.3f), prepare draw %.3f ms/frame (min %.3f)\n",
+		   animate_sum/frames, animate_min, prepare_sum/frames, prepare_min);
+
+	std::vector<cEffect*>::iterator it;
+	FOR_EACH(effects, it)
+		(*it)->Release();
+	camera->Release();
+	return 0;
+}
@@ -432,12 +432,23 @@ void findGameContent() {
 
     //Path for content in preferences path
     std::string prefPath;
+    std::string indexPath;
     const char* prefPath_ptr = GET_PREF_PATH();
     if (prefPath_ptr) {
         prefPath = prefPath_ptr;
+        indexPath = prefPath + "content_index.bin";
         prefPath += "Content";
         SDL_free((void*) prefPath_ptr);
     }
+
+    //Directory listings index to avoid listing whole content on each start,
+    //content_index=0 disables it, content_index=background uses stored listings and checks them after loading
+    const char* cmdlineIndex = check_command_line("content_index");
+    std::string indexMode = cmdlineIndex ? cmdlineIndex : "";
+    if (indexMode == "0") {
+        indexPath.clear();
+    }
+    set_content_index(indexPath, indexMode == "background");
     
 #ifndef _WIN32
     //On other OS data is usually separated from executable so is wise to check there first
@@ -1133,6 +1144,9 @@ void loadPendingMods() {
         loadModCommon(mod);
     }
     gameModsPending.clear();
+
+    //All content is mapped now, keep listings for next start
+    save_content_index();
     
     //Dump full path list if requested
     if (check_command_line("content_dump_debug")) {
@@ -0,0 +1,266 @@
+#include "StdAfx.h"
+#include "Runtime.h"
+#include "Grid2D.h"
+
+// Замеры сетки юнитов без мира:
+//	perimeter graph=headless grid_bench=<storage|engagement> [grid_bench_units=2000] [grid_bench_frames=100]
+// storage - одни и те же движущиеся юниты в сетке с ячейками GridVector, GridSingleList и GridPool:
+// каждый кадр Move всех юнитов и Scan вокруг каждого. Порядок обхода GridPool сверяется с GridVector,
+// GridPool<lifo> - с GridSingleList.
+// engagement - две стороны по units/2 идут навстречу и сходятся в центре карты, каждый кадр все
+// юниты сдвигаются в сетке и ищут цели в радиусе огня так же, как отряд, техник и дизинтегратор:
+// сбор кандидатов в переиспользуемый буфер, затем полная сортировка, первые GRID_BENCH_TOP
+// (partial_sort) и выдача из кучи по одному. Выбранные цели сверяются с полной сортировкой.
+// Код возврата 2 - порядок обхода или выбор отличается.
+
+static const int GRID_BENCH_WORLD = 2048;
+static const int GRID_BENCH_UNIT_RADIUS = 8;
+static const float GRID_BENCH_FIRE_RADIUS = 150;
+static const int GRID_BENCH_TOP = 5;
+static const int GRID_BENCH_HEAP_POPS = 8;
+
+struct GridBenchUnit : GridElementType
+{
+	Vect2f position;
+	Vect2f velocity;
+	int side;
+	unsigned int id;
+	float kill_priority;
+};
+
+//Как terUnitGridType
+typedef Grid2D<GridBenchUnit, 5, GridVector<GridBenchUnit, 8> > GridBenchGrid;
+
+struct GridBenchTarget
+{
+	GridBenchUnit* unit;
+	float factor;
+};
+
+//Как TargetOrderingOp в Squad.cpp: по убыванию приоритета, затем номера
+struct GridBenchOrderingOp
+{
+	bool operator()(const GridBenchTarget& t0, const GridBenchTarget& t1) const {
+		return std::tie(t0.factor, t0.unit->id) > std::tie(t1.factor, t1.unit->id);
+	}
+};
+
+struct GridBenchHeapOrderingOp
+{
+	bool operator()(const GridBenchTarget& t0, const GridBenchTarget& t1) const { return GridBenchOrderingOp()(t1, t0); }
+};
+
+class GridBenchTargetsOp
+{
+public:
+	GridBenchTargetsOp(const GridBenchUnit& unit, std::vector<GridBenchTarget>& targets) : unit_(unit), targets_(targets)
+	{
+		targets_.clear();
+	}
+
+	void operator()(GridBenchUnit* unit)
+	{
+		if(unit->side == unit_.side)
+			return;
+		float dist2 = unit->position.distance2(unit_.position);
+		if(dist2 < sqr(GRID_BENCH_FIRE_RADIUS)){
+			GridBenchTarget target = { unit, sqr(unit->kill_priority) + 1.f/(1.f + dist2) };
+			targets_.push_back(target);
+		}
+	}
+
+private:
+	const GridBenchUnit& unit_;
+	std::vector<GridBenchTarget>& targets_;
+};
+
+static void grid_bench_place(std::vector<GridBenchUnit>& units, int count)
+{
+	RandomGenerator rnd;
+	units.resize(count);
+	for(int i = 0; i < count; i++){
+		GridBenchUnit& unit = units[i];
+		unit.side = i & 1;
+		unit.id = i + 1;
+		unit.kill_priority = rnd(4);
+		float x = GRID_BENCH_WORLD*(unit.side ? 0.6f : 0.4f) + rnd.frnd(GRID_BENCH_WORLD*0.1f);
+		float y = GRID_BENCH_WORLD*0.5f + rnd.frnd(GRID_BENCH_WORLD*0.2f);
+		unit.position.set(x, y);
+		unit.velocity.set(unit.side ? -1.f : 1.f, rnd.frnd(0.5f));
+	}
+}
+
+//Сумма зависит от порядка обхода, по ней сверяются хранилища ячеек
+class GridBenchOrderOp
+{
+public:
+	unsigned int sum;
+	int visits;
+
+	GridBenchOrderOp() : sum(0), visits(0) {}
+	void operator()(GridBenchUnit* unit)
+	{
+		sum = sum*31 + unit->id;
+		visits++;
+	}
+};
+
+template<class CellList>
+static unsigned int grid_bench_storage_run(const char* name, int count, int frames)
+{
+	std::vector<GridBenchUnit> units;
+	grid_bench_place(units, count);
+
+	Grid2D<GridBenchUnit, 5, CellList> grid(GRID_BENCH_WORLD, GRID_BENCH_WORLD);
+	typename std::vector<GridBenchUnit>::iterator ui;
+	FOR_EACH(units, ui)
+		grid.Insert(*ui, xm::round(ui->position.x), xm::round(ui->position.y), GRID_BENCH_UNIT_RADIUS);
+
+	double frequency = getPerformanceFrequency()*1e-3;
+	double move_ms = 0, scan_ms = 0;
+	GridBenchOrderOp op;
+	for(int frame = 0; frame < frames; frame++){
+		uint64_t t0 = getPerformanceCounter();
+		FOR_EACH(units, ui){
+			ui->position += ui->velocity;
+			ui->position.x = clamp(ui->position.x, 0.f, GRID_BENCH_WORLD - 1.f);
+			ui->position.y = clamp(ui->position.y, 0.f, GRID_BENCH_WORLD - 1.f);
+			grid.Move(*ui, xm::round(ui->position.x), xm::round(ui->position.y), GRID_BENCH_UNIT_RADIUS);
+		}
+		uint64_t t1 = getPerformanceCounter();
+		FOR_EACH(units, ui)
+			grid.Scan(xm::round(ui->position.x), xm::round(ui->position.y), xm::round(GRID_BENCH_FIRE_RADIUS), op);
+		uint64_t t2 = getPerformanceCounter();
+		move_ms += (t1 - t0)/frequency;
+		scan_ms += (t2 - t1)/frequency;
+	}
+
+	printf("grid_bench: %-16s move %.3f ms/frame, scan %.3f ms/frame, %.1f units per scan\n",
+		   name, move_ms/frames, scan_ms/frames, double(op.visits)/(double(count)*frames));
+
+	FOR_EACH(units, ui)
+		grid.Remove(*ui);
+	return op.sum;
+}
+
+static int grid_bench_storage(int count, int frames)
+{
+	printf("grid_bench: storage, %d units, %d frames\n", count, frames);
+	unsigned int vector_sum = grid_bench_storage_run<GridVector<GridBenchUnit, 8> >("GridVector", count, frames);
+	unsigned int pool_sum = grid_bench_storage_run<GridPool<GridBenchUnit> >("GridPool", count, frames);
+	unsigned int list_sum = grid_bench_storage_run<GridSingleList<GridBenchUnit> >("GridSingleList", count, frames);
+	unsigned int pool_lifo_sum = grid_bench_storage_run<GridPool<GridBenchUnit, true> >("GridPool lifo", count, frames);
+
+	int differs = 0;
+	if(pool_sum != vector_sum){
+		fprintf(stderr, "grid_bench: GridPool scan order differs from GridVector\n");
+		differs++;
+	}
+	if(pool_lifo_sum != list_sum){
+		fprintf(stderr, "grid_bench: GridPool lifo scan order differs from GridSingleList\n");
+		differs++;
+	}
+	return differs ? 2 : 0;
+}
+
+static int grid_bench_engagement(int count, int frames)
+{
+	std::vector<GridBenchUnit> units;
+	grid_bench_place(units, count);
+
+	GridBenchGrid grid(GRID_BENCH_WORLD, GRID_BENCH_WORLD);
+	std::vector<GridBenchUnit>::iterator ui;
+	FOR_EACH(units, ui)
+		grid.Insert(*ui, xm::round(ui->position.x), xm::round(ui->position.y), GRID_BENCH_UNIT_RADIUS);
+
+	double frequency = getPerformanceFrequency()*1e-3;
+	double move_ms = 0, scan_ms = 0, sort_ms = 0, top_ms = 0, heap_ms = 0;
+	long long candidates = 0;
+	int searches = 0, differs = 0;
+	std::vector<GridBenchTarget> targets, sorted, top;
+	for(int frame = 0; frame < frames; frame++){
+		uint64_t t0 = getPerformanceCounter();
+		FOR_EACH(units, ui){
+			ui->position += ui->velocity;
+			ui->position.x = clamp(ui->position.x, 0.f, GRID_BENCH_WORLD - 1.f);
+			ui->position.y = clamp(ui->position.y, 0.f, GRID_BENCH_WORLD - 1.f);
+			grid.Move(*ui, xm::round(ui->position.x), xm::round(ui->position.y), GRID_BENCH_UNIT_RADIUS);
+		}
+		move_ms += (getPerformanceCounter() - t0)/frequency;
+
+		FOR_EACH(units, ui){
+			uint64_t t1 = getPerformanceCounter();
+			GridBenchTargetsOp op(*ui, targets);
+			grid.Scan(xm::round(ui->position.x), xm::round(ui->position.y), xm::round(GRID_BENCH_FIRE_RADIUS), op);
+			uint64_t t2 = getPerformanceCounter();
+			scan_ms += (t2 - t1)/frequency;
+			if(targets.empty())
+				continue;
+			searches++;
+			candidates += targets.size();
+
+			//Отряд: весь список по порядку
+			sorted = targets;
+			t1 = getPerformanceCounter();
+			std::sort(sorted.begin(), sorted.end(), GridBenchOrderingOp());
+			t2 = getPerformanceCounter();
+			sort_ms += (t2 - t1)/frequency;
+
+			//Техники: только первые по числу свободных
+			top = targets;
+			int top_count = std::min<int>(GRID_BENCH_TOP, top.size());
+			t1 = getPerformanceCounter();
+			std::partial_sort(top.begin(), top.begin() + top_count, top.end(), GridBenchOrderingOp());
+			t2 = getPerformanceCounter();
+			top_ms += (t2 - t1)/frequency;
+			for(int i = 0; i < top_count; i++)
+				if(top[i].unit != sorted[i].unit)
+					differs++;
+
+			//Дизинтегратор: из кучи, пока не кончилась энергия
+			t1 = getPerformanceCounter();
+			std::make_heap(targets.begin(), targets.end(), GridBenchHeapOrderingOp());
+			int pops = 0;
+			GridBenchUnit* popped[GRID_BENCH_HEAP_POPS];
+			while(!targets.empty() && pops < GRID_BENCH_HEAP_POPS){
+				std::pop_heap(targets.begin(), targets.end(), GridBenchHeapOrderingOp());
+				popped[pops++] = targets.back().unit;
+				targets.pop_back();
+			}
+			t2 = getPerformanceCounter();
+			heap_ms += (t2 - t1)/frequency;
+			for(int i = 0; i < pops; i++)
+				if(popped[i] != sorted[i].unit)
+					differs++;
+		}
+	}
+
+	printf("grid_bench: engagement, %d units, %d frames, %d searches, %.1f candidates per search\n",
+		   count, frames, searches, searches ? double(candidates)/searches : 0.);
+	printf("grid_bench: move %.3f ms/frame, scan %.3f us/unit\n", move_ms/frames, scan_ms*1e3/(double(count)*frames));
+	printf("grid_bench: sort %.3f us, top %d %.3f us, heap %d %.3f us per search\n",
+		   searches ? sort_ms*1e3/searches : 0., GRID_BENCH_TOP, searches ? top_ms*1e3/searches : 0.,
+		   GRID_BENCH_HEAP_POPS, searches ? heap_ms*1e3/searches : 0.);
+	if(differs)
+		fprintf(stderr, "grid_bench: %d selected targets differ from full sort\n", differs);
+
+	FOR_EACH(units, ui)
+		grid.Remove(*ui);
+	return differs ? 2 : 0;
+}
+
+int grid_benchmark(const char* mode)
+{
+	int units = 2000;
+	int frames = 100;
+	check_command_line_parameter("grid_bench_units", units);
+	check_command_line_parameter("grid_bench_frames", frames);
+
+	if(!strcmp(mode, "storage"))
+		return grid_bench_storage(units, frames);
+	if(!strcmp(mode, "engagement"))
+		return grid_bench_engagement(units, frames);
+
+	fprintf(stderr, "grid_bench: unknown mode %s, expected storage or engagement\n", mode);
+	return 1;
+}
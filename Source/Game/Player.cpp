@@ -250,12 +250,8 @@ void terPlayer::setAI(bool isAI)
 int terPlayer::registerUnitID(int unitID) 
 { 
 	UnitCount = max(unitID, UnitCount); 
-	UnitList::iterator ui;
-	for (auto unit : Units) {
-        if (unitID == unit->unitID()) {
-            return ++UnitCount;
-        }
-    }
+	if(unitRegistry_.find(unitID))
+		return ++UnitCount;
 	return unitID;
 }
 
@@ -364,6 +360,8 @@ void terPlayer::DeleteQuant()
 			}
 			else{
 				CUNITS_LOCK(this);
+				UnitList::iterator position;
+				unitRegistry_.remove(unit, position);
 				ui = Units.erase(ui);
 				removeUnit(unit);
 
@@ -464,6 +462,7 @@ void terPlayer::addUnit(terUnitBase* unit)
 
 	CUNITS_LOCK(this);
 	Units.push_back(unit);
+	unitRegistry_.add(unit, --Units.end());
 
 	if(unit->attr()->isBuilding()){// && unit->isBuilding()
 		BuildingList[unit->attr()->ID].push_back(safe_cast<terBuilding*>(unit));
@@ -496,7 +495,9 @@ void terPlayer::removeUnit(terUnitBase* unit)
 	}
 
 	CUNITS_LOCK(this);
-	Units.erase(remove(Units.begin(), Units.end(), unit), Units.end());
+	UnitList::iterator position;
+	if(unitRegistry_.remove(unit, position))
+		Units.erase(position);
 
 	if(frame_ == unit)
 		clearFrame();
@@ -768,75 +769,96 @@ void terPlayer::ScanAbyssRegion(RegionDispatcher* region)
 }
 
 //-------------------------------------------
+//Ближайший юнит; из равных - раньше добавленный, как при переборе списка Units
+class terNearestUnitOp
+{
+public:
+	terNearestUnitOp(const Vect2f& position, float distanceMin, bool constructedOnly)
+	: position_(position), distanceMin2_(sqr(distanceMin)), constructedOnly_(constructedOnly),
+	bestDist_(FLT_INF), bestOrder_(0), bestUnit_(0) {}
+
+	void operator()(const terUnitRegistry::Entry& entry) {
+		terUnitBase* unit = entry.unit;
+		float dist = position_.distance2(unit->position2D());
+		if(dist > distanceMin2_ && (bestDist_ > dist || (bestUnit_ && bestDist_ == dist && bestOrder_ > entry.order))
+		  && (!constructedOnly_ || unit->isConstructed() || unit->isUpgrading())){
+			bestDist_ = dist;
+			bestOrder_ = entry.order;
+			bestUnit_ = unit;
+		}
+	}
+
+	void operator()(const terUnitRegistry::Bucket& bucket) {
+		terUnitRegistry::Bucket::const_iterator bi;
+		FOR_EACH(bucket, bi)
+			(*this)(**bi);
+	}
+
+	terUnitBase* unit() const { return bestUnit_; }
+
+private:
+	Vect2f position_;
+	float distanceMin2_;
+	bool constructedOnly_;
+	float bestDist_;
+	unsigned int bestOrder_;
+	terUnitBase* bestUnit_;
+};
+
 terUnitBase* terPlayer::findUnit(terUnitAttributeID id)
 {
 	MTL();
-	UnitList::iterator ui;
-	FOR_EACH(Units,ui)
-		if((*ui)->attr()->ID == id)
-			return (*ui);
-		
-	return 0;
+	const terUnitRegistry::Bucket& bucket = unitRegistry_.attributeUnits(id);
+	return !bucket.empty() ? bucket.front()->unit : 0;
 }
 
 terUnitBase* terPlayer::findUnit(terUnitAttributeID id, const Vect2f& nearPosition, float distanceMin)
 {
 	MTL();
-	terUnitBase* bestUnit = 0;
-	float dist, bestDist = FLT_INF;
-	UnitList::iterator ui;
-	if(id != UNIT_ATTRIBUTE_ANY){
-		FOR_EACH(Units,ui)
-			if((*ui)->attr()->ID == id && bestDist > (dist = nearPosition.distance2((*ui)->position2D())) && dist > sqr(distanceMin)){
-				bestDist = dist;
-				bestUnit = *ui;
-			}
-	}
+	terNearestUnitOp op(nearPosition, distanceMin, false);
+	if(id != UNIT_ATTRIBUTE_ANY)
+		op(unitRegistry_.attributeUnits(id));
 	else{
-		FOR_EACH(Units,ui)
-			if((*ui)->attr()->ID < UNIT_ATTRIBUTE_LEGIONARY_MAX && bestDist > (dist = nearPosition.distance2((*ui)->position2D())) && dist > sqr(distanceMin)){
-				bestDist = dist;
-				bestUnit = *ui;
-			}
+		for(int i = 0; i < UNIT_ATTRIBUTE_LEGIONARY_MAX; i++)
+			op(unitRegistry_.attributeUnits(i));
 	}
-	return bestUnit;
+	return op.unit();
 }
 
 terUnitBase* terPlayer::findUnitByUnitClass(int unitClass, const Vect2f& nearPosition, float distanceMin)
 {
 	MTL();
-	terUnitBase* bestUnit = 0;
-	float dist, bestDist = FLT_INF;
-	UnitList::iterator ui;
-	FOR_EACH(Units,ui)
-		if(((*ui)->unitClass() & unitClass) && bestDist > (dist = nearPosition.distance2((*ui)->position2D())) 
-		  && ((*ui)->isConstructed() || (*ui)->isUpgrading()) && dist > sqr(distanceMin)){
-			bestDist = dist;
-			bestUnit = *ui;
-		}
-	return bestUnit;
+	terNearestUnitOp op(nearPosition, distanceMin, true);
+	unitRegistry_.scanClass(unitClass, op);
+	return op.unit();
 }
 
 terUnitBase* terPlayer::findUnit(unsigned int unit_id)
 {
 	MTL();
+	terUnitBase* unit = unitRegistry_.find(unit_id);
+#ifdef PERIMETER_DEBUG
+	//Индекс должен выбирать тот же юнит, что и перебор Units, в том числе после захвата
+	//или загрузки, когда номера совпадают
 	UnitList::iterator ui;
-	FOR_EACH(Units,ui)
+	FOR_EACH(Units, ui)
 		if((*ui)->unitID() == unit_id)
-			return (*ui);
-
-	return 0;
+			break;
+	xassert(unit == (ui != Units.end() ? *ui : 0));
+#endif
+	return unit;
 }
 
 terUnitBase* terPlayer::findUnitByLabel(const char* label)
 {
 	MTAuto lock(UnitsLock());
-	UnitList::iterator ui;
-	FOR_EACH(Units,ui)
-		if(!strcmp((*ui)->label(), label))
-			return (*ui);
-		
-		return 0;
+	return unitRegistry_.findLabel(label);
+}
+
+void terPlayer::updateUnitIndex(terUnitBase* unit)
+{
+	CUNITS_LOCK(this);
+	unitRegistry_.update(unit);
 }
 
 
@@ -9,6 +9,7 @@
 #include "Save.h"
 #include "SelectManager.h"
 #include "PerimeterSound.h"
+#include "UnitRegistry.h"
 
 class Event;
 class terFrame;
@@ -391,6 +392,14 @@ public:
 	void MoveQuant();
 	void CollisionQuant();
 
+	// Параллельный CollisionQuant: Order назначает последовательный порядок,
+	// Detect собирает кандидатов (можно из рабочих потоков),
+	// Apply применяет их в порядке CollisionQuant.
+	void CollisionOrder(int& order);
+	void CollisionDetect();
+	void CollisionApply(int unitsBuilt);
+	int unitsBuilt() const { return UnitCount; }
+
 	void RefreshAttribute();
 
 	void AvatarQuant();
@@ -442,6 +451,8 @@ public:
 	terUnitBase* findUnit(terUnitAttributeID id, const Vect2f& nearPosition, float distanceMin = 0);
 	terUnitBase* findUnitByLabel(const char* label);
 	terUnitBase* findUnitByUnitClass(int unitClass, const Vect2f& nearPosition, float distanceMin = 0);
+	//Юнит сменил unitID, класс или метку
+	void updateUnitIndex(terUnitBase* unit);
 
 	bool findPathToPoint(DefenceMap& defenceMap, const Vect2i& from_w, const Vect2i& to_w, std::vector<Vect2i>& out_path);
 	terUnitBase* findPathToTarget(DefenceMap& defenceMap, terUnitAttributeID id, terUnitBase* ignoreUnit, const Vect2f& nearPosition, Vect2iVect& path);
@@ -542,6 +553,7 @@ public:
 protected:
 	MTSection units_lock;
 	UnitList Units;
+	terUnitRegistry unitRegistry_;
 	SquadList squads;
 
 	std::list<double> begin_time_burn_zeroplast;
@@ -573,6 +585,17 @@ private:
 	sColor4f zeroLayerColor_;
 
 	int UnitCount;
+
+	struct CollisionCandidate
+	{
+		terUnitBase* unit;
+		terUnitBase* other;
+		CollisionCandidate(terUnitBase* unit_, terUnitBase* other_) : unit(unit_), other(other_) {}
+	};
+	typedef std::vector<CollisionCandidate> CollisionCandidateList;
+	CollisionCandidateList collisionCandidates_;
+	std::vector<terUnitGeneric*> collisionVisited_;
+	friend struct terRealCollisionCandidateOperator;
 	
 	terFrame* frame_;
 
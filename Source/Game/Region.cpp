@@ -102,11 +102,12 @@ void Cell::show(sColor4c color) const
 CellLine& CellLine::operator=(const CellLine& line)
 {
 	int areaInitial = area();
+	int sizeInitial = size();
 
-	static_cast<List&>(*this) = static_cast<const List&>(line);
+	static_cast<Vector&>(*this) = static_cast<const Vector&>(line);
 	
 	int delta = area() - areaInitial;
-	if(delta)
+	if(delta || sizeInitial != size())
 		setChanged(delta);
 
 	return *this;
@@ -115,17 +116,8 @@ CellLine& CellLine::operator=(const CellLine& line)
 void CellLine::find_interval(const Interval& in, iterator& il, iterator& ir_)
 {
 	// find [il, ir_) of Intervals wich intersects in
-    for (il = this->begin(); il != this->end(); ++il) {
-        if (il->xr >= in.xl) {
-            break;
-        }
-    }
-
-	for(ir_ = il; ir_ != end(); ++ir_) {
-        if (ir_->xl > in.xr) {
-            break;
-        }
-    }
+	il = seek(in.xl);
+	ir_ = std::upper_bound(il, end(), in.xr, [](int x, const Cell& c){ return x < c.xl; });
 }
 
 void CellLine::add(const Interval& in, Region* region)
@@ -151,15 +143,15 @@ void CellLine::add(const Interval& in, Region* region)
 				delta += in.xr - xr;
 				xr = in.xr;
 			}
-			while(il != ir){
-				int x = il->xr;
-				il = erase(il);
-				delta += il->xl - x - 1;
-			}
+			for(iterator i = il; i != ir; ++i)
+				delta += (i + 1)->xl - i->xr - 1;
+			//Слияние смежных ячеек не меняет площадь, но сдвигает вектор - указатели на ячейки устаревают
+			bool merged = il != ir;
+			ir = erase(il, ir);
 			ir->xl = xl;
 			ir->xr = xr;
 			ir->l_region = ir->r_region = region;
-			if(delta){
+			if(delta || merged){
 				//TODO what happens with neg delta? xassert(delta > 0);
 				setChanged(delta);
 			}
@@ -187,17 +179,15 @@ void CellLine::sub(const Interval& in, Region* region)
 			if(il->xl < in.xl){
 				//delta += 0;
 				il = insert(il, Cell(Interval(il->xl, in.xl - 1), y));
+				ir = il + 1;
 				il->l_region = ir->l_region;
 				il->r_region = region;
 				}
 			} 
 		else{
-			iterator i = il;
-			++i;
-			while(i != ir){
-				//delta -= i->delta();
-				i = erase(i);
-			}
+			//delta -= sum of (il, ir)->delta();
+			ir = erase(il + 1, ir);
+			il = ir - 1;
 			if(il->xl < in.xl){
 				//delta += (in.xl - 1) - il->xr;
 				il->xr = in.xl - 1;
@@ -205,7 +195,7 @@ void CellLine::sub(const Interval& in, Region* region)
 				}
 			else{
 				//delta -= il->delta();
-				erase(il);
+				ir = erase(il);
 			}
 		}
 
@@ -356,20 +346,19 @@ void CellLine::analyze(CellLine& line1, CellLine& line2, SeedList& seeds)
 
 Region* CellLine::locate(int x) const 
 { 
-	const_iterator i; 
-	FOR_EACH(*this, i) 
-		if(i->xl <= x && i->xr >= x){ 
-			if(i->l_region->positive())
-				return i->l_region;
-			else if(i->r_region->positive())
-				return i->r_region;
-			else{
-				for(++i; i != end(); ++i)
-					if(i->r_region->positive())
-						return i->r_region;
-				xassert(0);
-			}
-		} 
+	const_iterator i = seek(x); 
+	if(i != end() && i->xl <= x){ 
+		if(i->l_region->positive())
+			return i->l_region;
+		else if(i->r_region->positive())
+			return i->r_region;
+		else{
+			for(++i; i != end(); ++i)
+				if(i->r_region->positive())
+					return i->r_region;
+			xassert(0);
+		}
+	} 
 	return 0; 
 }
 
@@ -827,10 +816,8 @@ Region* Region::find_parent_to_append(Column& column)
 		return rr;
 
 	CellLine& line = column[handle_->y];
-	CellLine::iterator i;
-	FOR_EACH(line, i)
-		if(&*i == handle_)
-			break;
+	CellLine::iterator i = line.seek(handle_->xl);
+	xassert(i != line.end() && &*i == handle_);
 	
 	for(++i; i != line.end(); ++i)
 		if(i->r_region && i->r_region->positive())
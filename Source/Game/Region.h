@@ -49,13 +49,15 @@ public:
 typedef std::vector<Cell*> SeedList;
 class Column;
 
-class CellLine : public std::list<Cell>
+// Ячейки лежат подряд: любая вставка/удаление двигает их, поэтому такая строка
+// всегда помечается changed() и l_cw/r_cw в неё пересчитываются в analyze.
+class CellLine : public std::vector<Cell>
 {
-	typedef std::list<Cell> List;
+	typedef std::vector<Cell> Vector;
 
 public:
-	CellLine() : List() { y = 0; column_ = 0; changeCounter_ = 0; }
-	CellLine(const CellLine& line) : List() { y = 0; column_ = 0; changeCounter_ = 0; *this = line; }
+	CellLine() : Vector() { y = 0; column_ = 0; changeCounter_ = 0; }
+	CellLine(const CellLine& line) : Vector() { y = 0; column_ = 0; changeCounter_ = 0; *this = line; }
 	CellLine& operator=(const CellLine& line);
 
 	void add(const Interval& in, Region* region = 0);
@@ -66,13 +68,17 @@ public:
 	bool changed() const;
 	bool changedPrev() const;
 
-	bool filled(int x) const { const_iterator i; FOR_EACH(*this, i) if(i->xl <= x && x <= i->xr) return true; return false; }
+	// Интервалы отсортированы и не пересекаются: первый с xr >= x
+	iterator seek(int x) { return std::lower_bound(begin(), end(), x, [](const Cell& c, int x){ return c.xr < x; }); }
+	const_iterator seek(int x) const { return std::lower_bound(begin(), end(), x, [](const Cell& c, int x){ return c.xr < x; }); }
+
+	bool filled(int x) const { const_iterator i = seek(x); return i != end() && i->xl <= x; }
 	Region* locate(int x) const;
-	int intersected(const Interval& in) const { const_iterator i; FOR_EACH(*this, i) if(!(i->xr < in.xl || in.xr < i->xl)) return 1; return 0; }
+	int intersected(const Interval& in) const { const_iterator i = seek(in.xl); return i != end() && i->xl <= in.xr; }
 	int area() const { int a = 0; const_iterator i; FOR_EACH(*this, i) a += i->delta(); return a; }
 	
 	void find_interval(const Interval& in, iterator& il, iterator& ir_);
-	Cell* find(int x) { iterator i; FOR_EACH(*this, i) if(i->xl <= x && x <= i->xr) return &*i; return 0; }
+	Cell* find(int x) { iterator i = seek(x); return i != end() && i->xl <= x ? &*i : 0; }
 	void check();
 	void checkAnalyzing();
 	void show(sColor4c color) const;
@@ -80,7 +86,7 @@ public:
 	static void analyze(CellLine& line1, CellLine& line2, SeedList& seeds);
 
 	friend XBuffer& operator< (XBuffer& buf, const CellLine& line){ buf < line.y; write_container(buf, line); return buf; }
-	friend XBuffer& operator> (XBuffer& buf, CellLine& line){ buf > line.y; read_container(buf, line); return buf; }
+	friend XBuffer& operator> (XBuffer& buf, CellLine& line){ buf > line.y; read_vector(buf, static_cast<Vector&>(line)); return buf; }
 
 private:
 	int y;
@@ -0,0 +1,244 @@
+#include "StdAfx.h"
+#include "Runtime.h"
+#include "Universe.h"
+#include "Serialization.h"
+#include "../HT/ht.h"
+#include "../HT/JobPool.h"
+#include "../Util/Tracing.h"
+#include "files/files.h"
+
+#include <map>
+#include <cstdarg>
+
+// Прогон записи игры (.reel) на максимальной скорости:
+//	perimeter graph=headless replay_bench=<файл.reel> [replay_bench_quants=N] [replay_bench_out=<файл.json>]
+//		[replay_bench_save=<файл>] [replay_bench_check=<файл>] [replay_bench_seek=N] [logic_workers=N]
+// Логические кванты идут подряд в этом потоке, без синхронизации по времени, графики и звука.
+// После каждого кванта считается сигнатура - crc сетевого лога (log_var) и logicRND, как в logQuant,
+// только без обращения к генератору. save пишет сигнатуры по квантам, check сравнивает с ранее
+// записанными - расхождение значит, что логика перестала быть детерминированной.
+// Результат - JSON: кванты в секунду, время кванта и суммы по участкам трассировки (включая вложенные).
+// seek - после прогона N перемоток на равноотстоящие кванты, от конца к началу: время восстановления
+// из ключевого кадра с досчетом против времени прогона с начала, и совпадение сигнатуры следующего кванта.
+// С ключом replay_keyframes=<период в квантах> кадры снимаются и в самом прогоне, их время - в участке saveReplayKeyframe.
+// Код возврата 2 - сигнатуры разошлись с replay_bench_check.
+
+static void replay_bench_write_name(std::string& out, const char* name)
+{
+	for(; *name; ++name){
+		if(*name == '"' || *name == '\\')
+			out += '\\';
+		if(static_cast<unsigned char>(*name) >= ' ')
+			out += *name;
+	}
+}
+
+static void replay_bench_printf(std::string& out, const char* format, ...)
+{
+	char buf[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	out += buf;
+}
+
+static unsigned int replay_bench_signature()
+{
+	unsigned int signature = crc32(reinterpret_cast<const unsigned char*>(net_log_buffer.address()), net_log_buffer.tell(), startCRC32);
+	int rnd = logicRND.get();
+	signature = crc32(reinterpret_cast<const unsigned char*>(&rnd), sizeof(rnd), signature);
+	net_log_buffer.init();
+	return signature;
+}
+
+static bool replay_bench_load_signatures(const char* path, std::vector<unsigned int>& signatures)
+{
+	FILE* file = fopen(convert_path_native(path).c_str(), "rt");
+	if(!file)
+		return false;
+	unsigned int quant, signature;
+	while(fscanf(file, "%u %x", &quant, &signature) == 2){
+		if(signatures.size() <= quant)
+			signatures.resize(quant + 1, 0);
+		signatures[quant] = signature;
+	}
+	fclose(file);
+	return true;
+}
+
+int replay_benchmark(const char* reel)
+{
+	int max_quants = 0;
+	check_command_line_parameter("replay_bench_quants", max_quants);
+	const char* out_path = check_command_line("replay_bench_out");
+	const char* save_path = check_command_line("replay_bench_save");
+	const char* check_path = check_command_line("replay_bench_check");
+	int seeks = 0;
+	check_command_line_parameter("replay_bench_seek", seeks);
+
+	std::vector<unsigned int> expected;
+	if(check_path && !replay_bench_load_signatures(check_path, expected)){
+		fprintf(stderr, "replay_bench: can't read signatures %s\n", check_path);
+		return 1;
+	}
+	FILE* save_file = nullptr;
+	if(save_path){
+		save_file = fopen(convert_path_native(save_path).c_str(), "wt");
+		if(!save_file){
+			fprintf(stderr, "replay_bench: can't write signatures %s\n", save_path);
+			return 1;
+		}
+	}
+
+	MissionDescription mission(reel, GT_PLAY_RELL);
+	if(mission.worldID() == -1){
+		fprintf(stderr, "replay_bench: can't load reel %s\n", reel);
+		if(save_file)
+			fclose(save_file);
+		return 1;
+	}
+
+	HTManager* runtime = HTManager::instance();
+	runtime->GameStart(mission);
+	MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+
+	//Сигнатуры строятся по сетевому логу, в одиночной игре он выключен
+	net_log_mode = true;
+	net_log_buffer.init();
+
+	bool trace_was_enabled = trace_enabled();
+	trace_enable(true);
+	TraceTotals totals;
+	trace_collect(totals);
+	totals.clear();
+
+	unsigned int end_quant = universe()->endQuant_inReplayListGameCommands;
+	if(max_quants > 0 && static_cast<unsigned int>(max_quants) < end_quant)
+		end_quant = max_quants;
+
+	JobPool* job_pool = JobPool::instance();
+	printf("replay_bench: %s, %u quants, %d workers\n", reel, end_quant, job_pool ? job_pool->workers() : 0);
+
+	double frequency = getPerformanceFrequency()*1e-3;
+	double quant_sum = 0, quant_min = 1e10, quant_max = 0;
+	unsigned int signature_total = startCRC32;
+	int quants = 0, checked = 0, mismatch_quant = 0;
+	std::vector<unsigned int> signatures;
+	std::vector<double> quant_times;
+	while(universe()->getCurrentGameQuant() < end_quant){
+		uint64_t t0 = getPerformanceCounter();
+		bool ok = runtime->LogicQuantUnpaced();
+		uint64_t t1 = getPerformanceCounter();
+		if(!ok)
+			break;
+
+		double time = (t1 - t0)/frequency;
+		quant_sum += time;
+		quant_min = std::min(quant_min, time);
+		quant_max = std::max(quant_max, time);
+		quants++;
+		trace_collect(totals);
+
+		unsigned int quant = universe()->getCurrentGameQuant();
+		unsigned int signature = replay_bench_signature();
+		if(signatures.size() <= quant){
+			signatures.resize(quant + 1, 0);
+			quant_times.resize(quant + 1, 0);
+		}
+		signatures[quant] = signature;
+		quant_times[quant] = time;
+		signature_total = crc32(reinterpret_cast<const unsigned char*>(&signature), sizeof(signature), signature_total);
+
+		if(save_file)
+			fprintf(save_file, "%u %08x\n", quant, signature);
+		if(quant < expected.size() && expected[quant]){
+			checked++;
+			if(expected[quant] != signature && !mismatch_quant){
+				mismatch_quant = quant;
+				fprintf(stderr, "replay_bench: signature mismatch at quant %u\n", quant);
+			}
+		}
+	}
+
+	if(save_file)
+		fclose(save_file);
+	int keyframes = universe()->replayKeyframes.size();
+
+	//Перемотки назад - каждая с восстановлением из кадра, а не досчетом от текущего кванта
+	std::string seeks_json;
+	unsigned int last_quant = signatures.size() ? signatures.size() - 1 : 0;
+	for(int i = seeks; i > 0 && last_quant > 1; i--){
+		unsigned int quant = std::max(last_quant*i/(seeks + 1), 1u);
+		const terHyperSpace::ReplayKeyframe* keyframe = universe()->findReplayKeyframe(quant - 1);
+		int keyframe_quant = keyframe ? keyframe->quant : -1;
+
+		uint64_t t0 = getPerformanceCounter();
+		bool ok = runtime->seekReplay(quant - 1);
+		uint64_t t1 = getPerformanceCounter();
+		MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+
+		//Новая вселенная выключает сетевой лог
+		net_log_mode = true;
+		net_log_buffer.init();
+		bool match = ok && runtime->LogicQuantUnpaced() && universe()->getCurrentGameQuant() == quant &&
+					 replay_bench_signature() == signatures[quant];
+
+		double replay_ms = 0;
+		for(unsigned int q = 0; q < quant; q++)
+			replay_ms += quant_times[q];
+		seeks_json += seeks_json.empty() ? "" : ",";
+		replay_bench_printf(seeks_json, "\n\t{\"quant\": %u, \"keyframe\": %d, \"ms\": %.3f, \"replay_ms\": %.3f, \"match\": %s}",
+							quant, keyframe_quant, (t1 - t0)/frequency, replay_ms, match ? "true" : "false");
+	}
+
+	net_log_mode = false;
+	trace_enable(trace_was_enabled);
+
+	//Одно имя может стоять в разных местах - сводим по строке
+	std::map<std::string, TraceTotal> subsystems;
+	for(TraceTotals::const_iterator it = totals.begin(); it != totals.end(); ++it){
+		if(!it->first)
+			continue;
+		TraceTotal& total = subsystems[it->first];
+		total.time += it->second.time;
+		total.count += it->second.count;
+	}
+	std::vector<std::pair<std::string, TraceTotal>> sorted(subsystems.begin(), subsystems.end());
+	std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, TraceTotal>& a, const std::pair<std::string, TraceTotal>& b) {
+		return a.second.time > b.second.time;
+	});
+
+	double seconds = quant_sum*1e-3;
+	std::string json = "{\n\"reel\": \"";
+	replay_bench_write_name(json, reel);
+	replay_bench_printf(json, "\",\n\"quants\": %d,\n\"workers\": %d,\n\"seconds\": %.3f,\n\"quants_per_second\": %.1f,\n",
+						quants, job_pool ? job_pool->workers() : 0, seconds, seconds > 0 ? quants/seconds : 0);
+	replay_bench_printf(json, "\"quant_ms\": {\"mean\": %.4f, \"min\": %.4f, \"max\": %.4f},\n",
+						quants ? quant_sum/quants : 0, quants ? quant_min : 0, quant_max);
+	replay_bench_printf(json, "\"signature\": \"%08x\",\n\"signature_check\": {\"checked\": %d, \"first_mismatch_quant\": %d},\n\"subsystems\": [",
+						signature_total, checked, mismatch_quant);
+	for(int i = 0; i < sorted.size(); i++){
+		double ms = sorted[i].second.time/frequency;
+		json += i ? ",\n\t{\"name\": \"" : "\n\t{\"name\": \"";
+		replay_bench_write_name(json, sorted[i].first.c_str());
+		replay_bench_printf(json, "\", \"calls\": %d, \"ms\": %.3f, \"ms_per_quant\": %.4f, \"share\": %.4f}",
+							sorted[i].second.count, ms, quants ? ms/quants : 0, quant_sum > 0 ? ms/quant_sum : 0);
+	}
+	replay_bench_printf(json, "\n],\n\"keyframes\": %d,\n\"seeks\": [", keyframes);
+	json += seeks_json;
+	json += "\n]\n}\n";
+
+	if(out_path){
+		FILE* file = fopen(convert_path_native(out_path).c_str(), "wt");
+		if(!file){
+			fprintf(stderr, "replay_bench: can't write %s\n", out_path);
+			return 1;
+		}
+		fputs(json.c_str(), file);
+		fclose(file);
+	}
+	fputs(json.c_str(), stdout);
+
+	return mismatch_quant ? 2 : 0;
+}
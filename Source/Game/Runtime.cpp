@@ -415,6 +415,7 @@ void HTManager::done()
 
 bool HTManager::LogicQuant()
 {
+	trace_scope(HTLogicQuant);
 	{
 		MTAuto lock(&lock_logic);
 		if(universe())
@@ -447,8 +448,18 @@ bool HTManager::LogicQuant()
 	return b;
 }
 
+bool HTManager::LogicQuantUnpaced()
+{
+	bool b=LogicQuant();
+	//Nobody draws - let ClearDeleteUnit see the graphics as caught up
+	if(universe())
+		terVisGeneric->SetGraphLogicQuant(universe()->quantCounter());
+	return b;
+}
+
 void HTManager::GraphQuant()
 {
+	trace_scope(HTGraphQuant);
 	if(universe())
 	{
 		int quant_counter=universe()->quantCounter();
@@ -1132,6 +1143,22 @@ void mainLoop() {
 }
 #endif
 
+//Замеры без главного цикла: ключ командной строки со значением и обработчик, код возврата - код программы
+struct CommandLineTool
+{
+    const char* key;
+    int (*run)(const char* value);
+    bool drives_logic; //Сам гоняет логику в этом потоке - без отдельного логического потока
+};
+
+static const CommandLineTool commandLineTools[] = {
+    { "effect_bench", effect_benchmark, false },
+    { "replay_bench", replay_benchmark, true },
+    { "astar_bench", astar_benchmark, true },
+    { "grid_bench", grid_benchmark, false },
+    { "crc_bench", crc_benchmark, false },
+};
+
 int SDL_main(int argc, char *argv[])
 {
     //Show help if requested
@@ -1286,9 +1313,35 @@ int SDL_main(int argc, char *argv[])
     check_command_line_parameter("HT", mt);
     MTConfig::setMultithreading(mt);
 
+    int logic_workers = 0;
+    IniManager("Perimeter.ini").getInt("Game", "LogicWorkers", logic_workers);
+    check_command_line_parameter("logic_workers", logic_workers);
+    MTConfig::setLogicWorkers(logic_workers);
+
+    const CommandLineTool* cmdline_tool = nullptr;
+    const char* cmdline_tool_value = nullptr;
+    for (const CommandLineTool& tool : commandLineTools) {
+        cmdline_tool_value = check_command_line(tool.key);
+        if (cmdline_tool_value) {
+            cmdline_tool = &tool;
+            break;
+        }
+    }
+    if (cmdline_tool && cmdline_tool->drives_logic) {
+        MTConfig::setMultithreading(0);
+    }
+
     auto runtime_object = new HTManager();
     xassert(!(gameShell && gameShell->alwaysRun() && terFullScreen));
 
+    if (cmdline_tool) {
+        int result = cmdline_tool->run(cmdline_tool_value);
+        delete runtime_object;
+        SDLNet_Quit();
+        SDL_Quit();
+        return result;
+    }
+
     const char* cmdline_testcrash = check_command_line("testcrash");
     if (cmdline_testcrash) {
         if (*cmdline_testcrash == '0') {
@@ -18,6 +18,17 @@ void SoundQuant();
 void FinitSound();
 void request_application_restart(std::vector<std::string>* args = nullptr);
 
+//Замер частиц без вывода, ключ effect_bench=<библиотеки эффектов через запятую>
+int effect_benchmark(const char* libraries);
+//Прогон записи без графики и синхронизации по времени, ключ replay_bench=<файл .reel>
+int replay_benchmark(const char* reel);
+//Открытые списки AIAStar на карте проходимости мира, ключ astar_bench=<миссия или сохранение>
+int astar_benchmark(const char* mission);
+//Сетка юнитов без мира, ключ grid_bench=<режим>
+int grid_benchmark(const char* mode);
+//Реализации crc32 на буферах размера мира, ключ crc_bench=<сторона мира>
+int crc_benchmark(const char* side);
+
 //--------------------------------------
 extern class cVisGeneric* terVisGeneric;
 extern class cInterfaceRenderDevice* terRenderDevice;
@@ -0,0 +1,161 @@
+#include "StdAfx.h"
+
+#include "GenericControls.h"
+#include "UnitRegistry.h"
+
+terUnitRegistry::terUnitRegistry()
+: order_(0),
+attributeBuckets_(UNIT_ATTRIBUTE_MAX)
+{
+}
+
+void terUnitRegistry::add(terUnitBase* unit, UnitList::iterator position)
+{
+	Links& links = entries_[unit];
+	Entry& entry = links.entry;
+	entry.unit = unit;
+	entry.order = order_++;
+	entry.position = position;
+	entry.unitID = unit->unitID();
+	entry.unitClass = unit->unitClass();
+	entry.label = unit->label();
+
+	insertId(links);
+
+	int attribute_id = unit->attr()->ID;
+	xassert(attribute_id >= 0 && attribute_id < UNIT_ATTRIBUTE_MAX);
+	Bucket& attribute = attributeBuckets_[attribute_id];
+	links.attribute = attribute.insert(attribute.end(), &entry);
+
+	Bucket& unitClass = classBuckets_[entry.unitClass];
+	links.unitClass = unitClass.insert(unitClass.end(), &entry);
+
+	insertLabel(links);
+}
+
+bool terUnitRegistry::remove(terUnitBase* unit, UnitList::iterator& position)
+{
+	std::unordered_map<terUnitBase*, Links>::iterator ei = entries_.find(unit);
+	if(ei == entries_.end())
+		return false;
+
+	Links& links = ei->second;
+	Entry& entry = links.entry;
+	position = entry.position;
+
+	eraseId(links);
+	attributeBuckets_[unit->attr()->ID].erase(links.attribute);
+	eraseClass(links);
+
+	std::unordered_map<std::string, Bucket>::iterator li = labelBuckets_.find(entry.label);
+	li->second.erase(links.label);
+	if(li->second.empty())
+		labelBuckets_.erase(li);
+
+	entries_.erase(ei);
+	return true;
+}
+
+void terUnitRegistry::update(terUnitBase* unit)
+{
+	std::unordered_map<terUnitBase*, Links>::iterator ei = entries_.find(unit);
+	if(ei == entries_.end())
+		return;
+
+	Links& links = ei->second;
+	Entry& entry = links.entry;
+
+	if(entry.unitID != unit->unitID()){
+		eraseId(links);
+		entry.unitID = unit->unitID();
+		insertId(links);
+	}
+
+	//Классы перебираются с выбором по order, порядок внутри корзины не важен
+	if(entry.unitClass != unit->unitClass()){
+		eraseClass(links);
+		entry.unitClass = unit->unitClass();
+		Bucket& unitClass = classBuckets_[entry.unitClass];
+		links.unitClass = unitClass.insert(unitClass.end(), &entry);
+	}
+
+	if(entry.label != unit->label()){
+		std::unordered_map<std::string, Bucket>::iterator li = labelBuckets_.find(entry.label);
+		li->second.erase(links.label);
+		if(li->second.empty())
+			labelBuckets_.erase(li);
+		entry.label = unit->label();
+		insertLabel(links);
+	}
+}
+
+void terUnitRegistry::clear()
+{
+	entries_.clear();
+	idBuckets_.clear();
+	std::vector<Bucket>::iterator bi;
+	FOR_EACH(attributeBuckets_, bi)
+		bi->clear();
+	classBuckets_.clear();
+	labelBuckets_.clear();
+}
+
+terUnitBase* terUnitRegistry::find(unsigned int unit_id) const
+{
+	std::unordered_map<unsigned int, Bucket>::const_iterator ii = idBuckets_.find(unit_id);
+	return ii != idBuckets_.end() ? ii->second.front()->unit : 0;
+}
+
+terUnitBase* terUnitRegistry::findLabel(const char* label) const
+{
+	std::unordered_map<std::string, Bucket>::const_iterator li = labelBuckets_.find(label);
+	return li != labelBuckets_.end() ? li->second.front()->unit : 0;
+}
+
+const terUnitRegistry::Bucket& terUnitRegistry::attributeUnits(int attribute_id) const
+{
+	if(attribute_id < 0 || attribute_id >= UNIT_ATTRIBUTE_MAX)
+		return emptyBucket_;
+	return attributeBuckets_[attribute_id];
+}
+
+void terUnitRegistry::insertId(Links& links)
+{
+	links.id = insertOrdered(idBuckets_[links.entry.unitID], links.entry);
+}
+
+void terUnitRegistry::eraseId(Links& links)
+{
+	//Следующий по порядку юнит с тем же номером становится найденным
+	std::unordered_map<unsigned int, Bucket>::iterator ii = idBuckets_.find(links.entry.unitID);
+	ii->second.erase(links.id);
+	if(ii->second.empty())
+		idBuckets_.erase(ii);
+}
+
+void terUnitRegistry::insertLabel(Links& links)
+{
+	//Метка меняется только при загрузке
+	links.label = insertOrdered(labelBuckets_[links.entry.label], links.entry);
+}
+
+terUnitRegistry::Bucket::iterator terUnitRegistry::insertOrdered(Bucket& bucket, Entry& entry)
+{
+	//Корзина держится упорядоченной по order, первый юнит спереди
+	Bucket::iterator bi = bucket.end();
+	while(bi != bucket.begin()){
+		Bucket::iterator prev = bi;
+		if((*--prev)->order < entry.order)
+			break;
+		bi = prev;
+	}
+	return bucket.insert(bi, &entry);
+}
+
+void terUnitRegistry::eraseClass(Links& links)
+{
+	ClassMap::iterator ci = classBuckets_.find(links.entry.unitClass);
+	ci->second.erase(links.unitClass);
+	if(ci->second.empty())
+		classBuckets_.erase(ci);
+}
@@ -0,0 +1,95 @@
+#ifndef __UNIT_REGISTRY_H__
+#define __UNIT_REGISTRY_H__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class terUnitBase;
+
+/////////////////////////////////////////////////////////////////////////////////
+//		Индексы юнитов игрока
+// По unitID, по атрибуту, по классу и по метке - вместо перебора списка Units.
+// Каждый юнит получает порядковый номер добавления - его позиция в Units,
+// поиск среди равных кандидатов выбирает меньший номер, поэтому результат
+// тот же, что и при переборе списка (важно для синхронности).
+// unitID уникален не всегда (после загрузки или захвата юнит может совпасть по номеру
+// с другим), поэтому по номеру, как и по метке, хранится упорядоченная корзина.
+/////////////////////////////////////////////////////////////////////////////////
+
+class terUnitRegistry
+{
+public:
+	typedef std::list<terUnitBase*> UnitList;
+
+	struct Entry
+	{
+		terUnitBase* unit;
+		unsigned int order;
+		UnitList::iterator position; //в списке Units игрока
+
+		//Значения, по которым юнит сейчас лежит в индексах
+		unsigned int unitID;
+		int unitClass;
+		std::string label;
+	};
+	typedef std::list<Entry*> Bucket;
+
+	terUnitRegistry();
+
+	void add(terUnitBase* unit, UnitList::iterator position);
+	//false - юнит не зарегистрирован
+	bool remove(terUnitBase* unit, UnitList::iterator& position);
+	//После смены unitID, класса или метки
+	void update(terUnitBase* unit);
+	void clear();
+
+	terUnitBase* find(unsigned int unit_id) const;
+	terUnitBase* findLabel(const char* label) const;
+
+	//В порядке добавления
+	const Bucket& attributeUnits(int attribute_id) const;
+
+	//Перебор юнитов, у которых есть общие биты с маской классов; порядок - по классам,
+	//для выбора среди равных использовать Entry::order
+	template<class Op>
+	void scanClass(int unit_class, Op& op) const {
+		ClassMap::const_iterator ci;
+		for(ci = classBuckets_.begin(); ci != classBuckets_.end(); ++ci)
+			if(ci->first & unit_class){
+				Bucket::const_iterator bi;
+				for(bi = ci->second.begin(); bi != ci->second.end(); ++bi)
+					op(**bi);
+			}
+	}
+
+private:
+	struct Links
+	{
+		Entry entry;
+		Bucket::iterator id;
+		Bucket::iterator attribute;
+		Bucket::iterator unitClass;
+		Bucket::iterator label;
+	};
+
+	typedef std::map<int, Bucket> ClassMap;
+
+	unsigned int order_;
+	std::unordered_map<terUnitBase*, Links> entries_;
+	std::unordered_map<unsigned int, Bucket> idBuckets_;
+	std::vector<Bucket> attributeBuckets_;
+	ClassMap classBuckets_;
+	std::unordered_map<std::string, Bucket> labelBuckets_;
+	Bucket emptyBucket_;
+
+	void insertId(Links& links);
+	void eraseId(Links& links);
+	void insertLabel(Links& links);
+	static Bucket::iterator insertOrdered(Bucket& bucket, Entry& entry);
+	void eraseClass(Links& links);
+};
+
+#endif //__UNIT_REGISTRY_H__
@@ -64,6 +64,7 @@
 #include "PerimeterShellUI.h"
 #include "ExternalShow.h"
 #include "../HT/ht.h"
+#include "../HT/JobPool.h"
 
 #include "qd_textdb.h"
 
@@ -249,6 +250,7 @@ void terUniverse::Quant()
 
 	vMap.changedAreas.clear();
 	if(field_dispatcher){
+		start_timer_auto(FieldQuant, STATISTICS_GROUP_LOGIC);
 		field_dispatcher->logicQuant();
 		log_var_crc(field_dispatcher->height_array(), field_dispatcher->mapSizeX()*field_dispatcher->mapSizeY());
 	}
@@ -257,14 +259,16 @@ void terUniverse::Quant()
 
 	terRealCollisionCount++;
 	terMapUpdatedCount++;
-	PlayerVect::iterator pi;
-	FOR_EACH(Players, pi)
-		(*pi)->CollisionQuant();
+	CollisionQuant();
 
 	multibody_dispatcher.resolve();
 
-	FOR_EACH(Players, pi)
-		(*pi)->MoveQuant();
+	PlayerVect::iterator pi;
+	{
+		start_timer_auto(MoveQuant, STATISTICS_GROUP_LOGIC);
+		FOR_EACH(Players, pi)
+			(*pi)->MoveQuant();
+	}
 
 	FOR_EACH(Players, pi)
 		(*pi)->Quant();
@@ -279,8 +283,9 @@ void terUniverse::Quant()
 		}
 	changeOwnerList.clear();
 
-	std::list<sRectS>::iterator i_area;
-	FOR_EACH(vMap.changedAreas,i_area){
+	//Юниты и доверие получают сырые области по одной, как раньше: объединенные сдвигают попадания
+	sChangedAreas::const_iterator i_area;
+	FOR_EACH(vMap.changedAreas.raw(),i_area){
 		terMapUnitUpdateOperator unit_op((int)(i_area->x),(int)(i_area->y),(int)(i_area->x + i_area->dx),(int)(i_area->y + i_area->dy));
 		UnitGrid.Scan(unit_op.x0, unit_op.y0, unit_op.x1, unit_op.y1, unit_op);
 
@@ -296,19 +301,29 @@ void terUniverse::Quant()
 
 	terCamera->destroyLink();
 
-	FOR_EACH(Players, pi)
-		(*pi)->EconomicQuant();
+	{
+		start_timer_auto(EconomicQuant, STATISTICS_GROUP_LOGIC);
+		FOR_EACH(Players, pi)
+			(*pi)->EconomicQuant();
+	}
 
 	clearLinkAndDelete();
 
 	cluster_column_.setUnchanged();
-	std::list<sRectS>::iterator rc;
+	//Карте путей порядок не важен, ей хватит объединенных; могли добавиться области при удалении юнитов
+	vMap.changedAreas.coalesce();
+	statistics_add(changedAreasRaw, STATISTICS_GROUP_NUMERIC, vMap.changedAreas.rawArea());
+	statistics_add(changedAreasMerged, STATISTICS_GROUP_NUMERIC, vMap.changedAreas.mergedArea());
+	sChangedAreas::const_iterator rc;
 	FOR_EACH(vMap.changedAreas,rc){
 		ai_tile_map->UpdateRect(rc->x,rc->y,rc->dx,rc->dy);
 		updateClusterColumn(*rc);
 	}
 
-	ai_tile_map->recalcPathFind();
+	{
+		start_timer_auto(recalcPathFind, STATISTICS_GROUP_LOGIC);
+		ai_tile_map->recalcPathFind();
+	}
 
 	AvatarQuant();
 	
@@ -321,19 +336,16 @@ void terUniverse::AvatarQuant()
 {
 	quant_counter_++;
 
-	stream_interpolator.Lock();
-	stream_interpolator.SetInAvatar(true);
 	start_timer_auto(AvatarQuant, STATISTICS_GROUP_LOGIC);
 
-	stream_interpolator.ClearData();
+	stream_interpolator.BeginFrame();
 
 	PlayerVect::iterator pi;
 	FOR_EACH(Players, pi)
 		(*pi)->AvatarQuant();
 	monks.avatarInterpolation();
 
-	stream_interpolator.SetInAvatar(false);
-	stream_interpolator.Unlock();
+	stream_interpolator.PublishFrame();
 
 	select.ShowCircles();
 }
@@ -1085,12 +1097,12 @@ bool terUniverse::universalLoad(MissionDescription& missionToLoad, SavePrm& data
     return true;
 }
 
-bool terUniverse::universalSave(MissionDescription& mission, bool userSave) const {
+bool terUniverse::universalSave(MissionDescription& mission, bool userSave, bool keyframe) const {
 	SavePrm data;
 
 	data.manualData = gameShell->manualData();
 
-	if (userSave) {
+	if (userSave && !keyframe) {
 		_shellIconManager.save(data.activeTasks);
 		data.manualData.interfaceEnabled = true;
 		
@@ -1136,7 +1148,10 @@ bool terUniverse::universalSave(MissionDescription& mission, bool userSave) cons
 
 	worldPlayer()->saveWorld(data);
 
-	gameShell->fillControlState(data.manualData.controls);
+	//Кадр снимается в логическом потоке, состояние интерфейса принадлежит графическому
+	if (!keyframe) {
+		gameShell->fillControlState(data.manualData.controls);
+	}
 
     XPrmOArchive oaSavePrm;
     oaSavePrm.binary_friendly = true;
@@ -1205,7 +1220,7 @@ bool terUniverse::universalSave(MissionDescription& mission, bool userSave) cons
     
     //---------------------
     // Replay data
-    if (userSave) {
+    if (userSave && !keyframe) {
         serializeGameCommands(binaryData);
     }
     uncompressedData < binaryData;
@@ -1402,6 +1417,120 @@ void terPlayer::CollisionQuant()
 	}
 }
 
+// Грубый отбор для terRealCollisionOperator без побочных эффектов:
+// только то, что не меняется во время применения - порядок и пересечение
+// сфер с запасом. Остальные проверки делает сам оператор.
+struct terRealCollisionCandidateOperator
+{
+	terUnitBase* unit_;
+	Vect3f Position;
+	float Radius;
+	int Order;
+	terPlayer::CollisionCandidateList& candidates_;
+
+	terRealCollisionCandidateOperator(terUnitBase* p, terPlayer::CollisionCandidateList& candidates) 
+	: candidates_(candidates)
+	{
+		unit_ = p;
+		Position = p->GetRigidBodyPoint()->position();
+		Radius = p->GetRigidBodyPoint()->radius();
+		Order = p->GetCollisionOrder(terRealCollisionCount);
+	}
+
+	void operator()(terUnitBase* p)
+	{
+		if(p->GetCollisionOrder(terRealCollisionCount) < Order){
+			RigidBody* b = p->GetRigidBodyPoint();
+			if(b && Position.distance2(b->matrix().trans()) < sqr(Radius + b->radius() + 1.f))
+				candidates_.push_back(terPlayer::CollisionCandidate(unit_, p));
+		}
+	}
+};
+
+void terPlayer::CollisionOrder(int& order)
+{
+	UnitList::iterator i_unit;
+	FOR_EACH(Units,i_unit)
+		(*i_unit)->SetCollisionOrder(terRealCollisionCount, order++);
+}
+
+void terPlayer::CollisionDetect()
+{
+	collisionCandidates_.clear();
+	UnitList::iterator i_unit;
+	FOR_EACH(Units,i_unit){
+		terUnitBase* p = *i_unit;
+		if(p->GetRigidBodyPoint()){
+			int x = p->position2D().xi();
+			int y = p->position2D().yi();
+			int r = xm::round(p->radius());
+			terRealCollisionCandidateOperator op(p, collisionCandidates_);
+			universe()->UnitGrid.ScanConcurrent(x, y, r, op, collisionVisited_);
+		}
+	}
+}
+
+void terPlayer::CollisionApply(int unitsBuilt)
+{
+	MTL();
+	CollisionCandidateList::iterator ci = collisionCandidates_.begin();
+	UnitList::iterator i_unit;
+	FOR_EACH(Units,i_unit){
+		terUnitBase* p = *i_unit;
+		if(p->alive()){
+			if(p->collisionGroup() & COLLISION_GROUP_REAL){
+				terRealCollisionOperator op(p);
+				if(unitsBuilt == universe()->unitsBuilt()){
+					for(; ci != collisionCandidates_.end() && ci->unit == p; ++ci)
+						op(ci->other);
+				}
+				else{
+					// Появились юниты, которых нет среди кандидатов
+					int x = p->position2D().xi();
+					int y = p->position2D().yi();
+					int r = xm::round(p->radius());
+					universe()->UnitGrid.Scan(x, y, r, op);
+				}
+			}
+		}
+		while(ci != collisionCandidates_.end() && ci->unit == p)
+			++ci;
+		p->SetRealCollisionCount(terRealCollisionCount);
+	}
+}
+
+void terUniverse::CollisionQuant()
+{
+	PlayerVect::iterator pi;
+	JobPool* job_pool = JobPool::instance();
+	if(!job_pool){
+		FOR_EACH(Players, pi)
+			(*pi)->CollisionQuant();
+		return;
+	}
+
+	start_timer_auto(CollisionQuantParallel, STATISTICS_GROUP_LOGIC);
+
+	int order = 0;
+	FOR_EACH(Players, pi)
+		(*pi)->CollisionOrder(order);
+
+	job_pool->run(Players.size(), [this](int i) { Players[i]->CollisionDetect(); }, "CollisionDetect");
+
+	int units_built = unitsBuilt();
+	FOR_EACH(Players, pi)
+		(*pi)->CollisionApply(units_built);
+}
+
+int terUniverse::unitsBuilt() const
+{
+	int units = 0;
+	PlayerVect::const_iterator pi;
+	FOR_EACH(Players, pi)
+		units += (*pi)->unitsBuilt();
+	return units;
+}
+
 //-----------------------------------------------------
 
 struct terRealHightOperator
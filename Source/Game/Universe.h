@@ -36,7 +36,8 @@ public:
 	void triggerQuant();
 
     bool universalLoad(MissionDescription& mission, SavePrm& data, PROGRESSCALLBACK loadProgressUpdate);
-	bool universalSave(MissionDescription& mission, bool userSave) const;
+	//keyframe - ключевой кадр записи: как пользовательское, но без интерфейса, камер, состояния кнопок и истории команд
+	bool universalSave(MissionDescription& mission, bool userSave, bool keyframe = false) const;
 	void relaxLoading();
 
 	void addLinkToResolve(const SaveUnitLink* link) { saveUnitLinks_.push_back(link); }
@@ -99,6 +100,8 @@ public:
 	const Column& clusterColumn() const { return cluster_column_; }
 
 	int quantCounter() const { return quant_counter_; }
+	//Сколько юнитов создано всеми игроками, по нему видно появление новых за фазу столкновений
+	int unitsBuilt() const;
 
 	void switchFieldTransparency();
 	bool fieldTransparent() const { return fieldTransparent_; }
@@ -160,6 +163,8 @@ private:
 	static terUniverse* universe_;
 
 	//-------------------------------
+	void CollisionQuant();
+
 	void loadZeroLayer();
 	void resolveLinks();
 };
@@ -0,0 +1,252 @@
+#include "StdAfx.h"
+#include "JobPool.h"
+#include "LagStatistic.h"
+
+
+JobPool* JobPool::self = nullptr;
+
+// Номер очереди рабочего потока, -1 для остальных потоков
+static thread_local int job_pool_worker = -1;
+
+// Внешняя очередь потока, назначается при первой постановке задания в пул поколения generation
+struct JobPoolExternalQueue
+{
+	int generation;
+	int index;
+};
+static thread_local JobPoolExternalQueue job_pool_external = { 0, -1 };
+static int job_pool_generation = 0;
+
+struct JobPoolThreadData
+{
+	JobPool* pool;
+	int index;
+};
+
+int job_pool_thread_init(void* data)
+{
+	JobPoolThreadData* thread_data = static_cast<JobPoolThreadData*>(data);
+	JobPool* pool = thread_data->pool;
+	int index = thread_data->index;
+	delete thread_data;
+
+	pool->worker(index);
+	return 0;
+}
+
+JobPool::JobPool(int workers)
+: queues_(workers + EXTERNAL_QUEUES),
+external_queues_(0),
+queued_(0),
+sleeping_(0),
+quit_(false),
+lag_stat_(nullptr),
+generation_(++job_pool_generation)
+{
+	xassert(!self);
+	self = this;
+
+	for(Queue& queue : queues_)
+		queue.mutex = SDL_CreateMutex();
+	sleep_mutex_ = SDL_CreateMutex();
+	wake_ = SDL_CreateCond();
+	done_mutex_ = SDL_CreateMutex();
+	done_ = SDL_CreateCond();
+
+	for(int i = 0; i < workers; i++){
+		SDL_Thread* thread = SDL_CreateThread(job_pool_thread_init, "perimeter_job_thread", new JobPoolThreadData{this, i});
+		if(!thread){
+			SDL_PRINT_ERROR("SDL_CreateThread perimeter_job_thread failed");
+			break;
+		}
+		threads_.push_back(thread);
+	}
+}
+
+JobPool::~JobPool()
+{
+	SDL_LockMutex(sleep_mutex_);
+	quit_ = true;
+	SDL_CondBroadcast(wake_);
+	SDL_UnlockMutex(sleep_mutex_);
+
+	for(SDL_Thread* thread : threads_)
+		SDL_WaitThread(thread, nullptr);
+
+	xassert(!queued_);
+
+	SDL_DestroyCond(done_);
+	SDL_DestroyMutex(done_mutex_);
+	SDL_DestroyCond(wake_);
+	SDL_DestroyMutex(sleep_mutex_);
+	for(Queue& queue : queues_)
+		SDL_DestroyMutex(queue.mutex);
+
+	self = nullptr;
+}
+
+int JobPool::queueIndex()
+{
+	if(job_pool_worker >= 0)
+		return job_pool_worker;
+
+	if(job_pool_external.generation != generation_){
+		int external = external_queues_++;
+		xassert(external < EXTERNAL_QUEUES && "JobPool: too many submitting threads, last queue is shared");
+		job_pool_external.generation = generation_;
+		job_pool_external.index = queues_.size() - EXTERNAL_QUEUES + std::min<int>(external, EXTERNAL_QUEUES - 1);
+	}
+	return job_pool_external.index;
+}
+
+void JobPool::wakeWorkers(int count)
+{
+	// queued_ увеличен до проверки, а рабочий увеличивает sleeping_ до проверки queued_ - пробуждение не теряется
+	if(!sleeping_)
+		return;
+
+	SDL_LockMutex(sleep_mutex_);
+	if(count > 1)
+		SDL_CondBroadcast(wake_);
+	else
+		SDL_CondSignal(wake_);
+	SDL_UnlockMutex(sleep_mutex_);
+}
+
+void JobPool::submit(Group& group, const char* name, const Task& task)
+{
+	group.pending_++;
+	if(threads_.empty()){
+		Entry entry = { task, &group, name };
+		execute(entry);
+		return;
+	}
+
+	queued_++;
+	Queue& queue = queues_[queueIndex()];
+	SDL_LockMutex(queue.mutex);
+	queue.tasks.push_back(Entry{ task, &group, name });
+	SDL_UnlockMutex(queue.mutex);
+
+	wakeWorkers(1);
+}
+
+void JobPool::wait(Group& group)
+{
+	while(!group.done()){
+		if(executeOne())
+			continue;
+
+		// Своих заданий в очередях нет - оставшиеся уже выполняются другими потоками
+		SDL_LockMutex(done_mutex_);
+		while(!group.done())
+			SDL_CondWait(done_, done_mutex_);
+		SDL_UnlockMutex(done_mutex_);
+	}
+}
+
+void JobPool::run(int count, const Job& job, const char* name)
+{
+	if(threads_.empty() || count < 2){
+		for(int i = 0; i < count; i++)
+			job(i);
+		return;
+	}
+
+	Group group;
+	group.pending_ += count;
+	queued_ += count;
+	Queue& queue = queues_[queueIndex()];
+	SDL_LockMutex(queue.mutex);
+	for(int i = 0; i < count; i++)
+		queue.tasks.push_back(Entry{ [&job, i]() { job(i); }, &group, name });
+	SDL_UnlockMutex(queue.mutex);
+
+	wakeWorkers(count);
+	wait(group);
+}
+
+bool JobPool::pop(int index, Entry& entry)
+{
+	Queue& queue = queues_[index];
+	SDL_LockMutex(queue.mutex);
+	bool found = !queue.tasks.empty();
+	if(found){
+		entry = std::move(queue.tasks.back());
+		queue.tasks.pop_back();
+	}
+	SDL_UnlockMutex(queue.mutex);
+	return found;
+}
+
+bool JobPool::steal(int thief, Entry& entry)
+{
+	int size = queues_.size();
+	for(int i = 1; i < size; i++){
+		Queue& queue = queues_[(thief + i) % size];
+		SDL_LockMutex(queue.mutex);
+		bool found = !queue.tasks.empty();
+		if(found){
+			entry = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		}
+		SDL_UnlockMutex(queue.mutex);
+		if(found)
+			return true;
+	}
+	return false;
+}
+
+bool JobPool::executeOne()
+{
+	if(!queued_)
+		return false;
+
+	// Внешний поток выполняет только свои задания, воруют только рабочие
+	int index = queueIndex();
+	Entry entry;
+	if(!pop(index, entry) && (job_pool_worker < 0 || !steal(index, entry)))
+		return false;
+
+	queued_--;
+	execute(entry);
+	return true;
+}
+
+void JobPool::execute(Entry& entry)
+{
+	uint64_t start = SDL_GetPerformanceCounter();
+	entry.task();
+	uint64_t end = SDL_GetPerformanceCounter();
+	float time = (end - start)*1000.f/SDL_GetPerformanceFrequency();
+
+	if(trace_enabled())
+		trace_record(entry.name, start, end);
+
+	if(lag_stat_)
+		lag_stat_->AddTaskTime(entry.name, time);
+
+	// Ожидающий wait() будится один раз - по последнему заданию группы
+	if(!--entry.group->pending_ && !threads_.empty()){
+		SDL_LockMutex(done_mutex_);
+		SDL_CondBroadcast(done_);
+		SDL_UnlockMutex(done_mutex_);
+	}
+}
+
+void JobPool::worker(int index)
+{
+	job_pool_worker = index;
+	trace_thread_name("job");
+	while(!quit_){
+		if(executeOne())
+			continue;
+
+		SDL_LockMutex(sleep_mutex_);
+		sleeping_++;
+		while(!quit_ && !queued_)
+			SDL_CondWait(wake_, sleep_mutex_);
+		sleeping_--;
+		SDL_UnlockMutex(sleep_mutex_);
+	}
+}
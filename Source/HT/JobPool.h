@@ -0,0 +1,97 @@
+#pragma once
+
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <SDL_thread.h>
+
+class LagStatistic;
+
+/*
+Планировщик заданий с очередью на каждый рабочий поток.
+Рабочий берет свои задания с конца очереди, а когда они кончаются -
+ворует у других с начала. Каждый внешний поток (логика, графика) ставит
+задания в свою очередь и, ожидая группу, выполняет только их - чужие задания
+не попадают в поток с другим MT типом. Закончив свои, он спит до завершения группы.
+Порядок выполнения не определен - результаты должны складываться по индексу
+и применяться вызывающим в фиксированном порядке.
+Время каждого задания уходит в LagStatistic.
+*/
+class JobPool
+{
+public:
+	typedef std::function<void()> Task;
+	typedef std::function<void(int)> Job;
+
+	// Счетчик незавершенных заданий, wait() ждет его обнуления
+	class Group
+	{
+	public:
+		Group() : pending_(0) {}
+		bool done() const { return !pending_; }
+
+	private:
+		std::atomic<int> pending_;
+		friend class JobPool;
+	};
+
+	enum { EXTERNAL_QUEUES = 4 }; // логика, графика и запас
+
+	explicit JobPool(int workers);
+	~JobPool();
+
+	// nullptr, если дополнительные потоки выключены
+	static JobPool* instance() { return self; }
+
+	int workers() const { return threads_.size(); }
+	void setLagStatistic(LagStatistic* lag_stat) { lag_stat_ = lag_stat; }
+
+	// name должен жить все время работы - используется в статистике
+	void submit(Group& group, const char* name, const Task& task);
+	// Вызывающий поток выполняет задания своей очереди (рабочий - и чужих),
+	// затем спит до завершения группы
+	void wait(Group& group);
+
+	// job(i) для i в [0, count), возвращается после выполнения всех.
+	// Задания ставятся в очередь разом и будят рабочих один раз
+	void run(int count, const Job& job, const char* name = "job");
+
+private:
+	struct Entry
+	{
+		Task task;
+		Group* group;
+		const char* name;
+	};
+
+	struct Queue
+	{
+		SDL_mutex* mutex;
+		std::deque<Entry> tasks;
+	};
+
+	static JobPool* self;
+
+	std::vector<SDL_Thread*> threads_;
+	std::vector<Queue> queues_; // по одной на рабочий поток, затем EXTERNAL_QUEUES внешних
+	std::atomic<int> external_queues_;
+	std::atomic<int> queued_;
+	std::atomic<int> sleeping_;
+	std::atomic<bool> quit_;
+	SDL_mutex* sleep_mutex_;
+	SDL_cond* wake_;
+	SDL_mutex* done_mutex_;
+	SDL_cond* done_;
+	LagStatistic* lag_stat_;
+	int generation_;
+
+	int queueIndex();
+	void wakeWorkers(int count);
+	bool pop(int queue, Entry& entry);
+	bool steal(int thief, Entry& entry);
+	bool executeOne();
+	void execute(Entry& entry);
+
+	friend int job_pool_thread_init(void*);
+	void worker(int index);
+};
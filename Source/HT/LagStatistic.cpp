@@ -46,15 +46,41 @@ void LagStatistic::NextLogicQuant()
 		list_data.pop_back();
 	}
 
+	std::map<std::string, TaskData>::iterator it;
+	FOR_EACH(task_data,it)
+	{
+		it->second.count_last=it->second.count;
+		it->second.count=0;
+	}
+
 	clear();
 }
 
+void LagStatistic::AddTaskTime(const char* name, float time)
+{
+	MTAuto lock(&lock_lag);
+	std::map<std::string, TaskData>::iterator it=task_data.find(name);
+	if(it==task_data.end())
+	{
+		TaskData d;
+		d.time=d.time_max=time;
+		d.count=d.count_last=0;
+		it=task_data.insert(std::make_pair(std::string(name),d)).first;
+	}
+
+	TaskData& d=it->second;
+	average(d.time,time,0.1f);
+	d.time_max=std::max(d.time_max*0.99f,time);
+	d.count++;
+}
+
 void LagStatistic::Show()
 {
 	MTAuto lock(&lock_lag);
 	int x= xm::round(terScreenSizeX * 0.85f);
 	int y= xm::round(terScreenSizeY * 0.1f);
 	ShowAverage(Vect2i(x,y),max_average_interval);
+	ShowTasks(Vect2i(x,xm::round(terScreenSizeY * 0.25f)));
 }
 
 void LagStatistic::CalcAverage(int interval,float& lag_quant,float& net_skip,float& net_wait)
@@ -107,6 +133,23 @@ void LagStatistic::ShowAverage(Vect2i pos,int interval)
 	pos.y+=height;
 }
 
+void LagStatistic::ShowTasks(Vect2i pos)
+{
+	Vect2f bmin,bmax;
+	terRenderDevice->OutTextRect(0,0,"A",-1,bmin,bmax);
+	int height= xm::round(bmax.y - bmin.y);
+	char str[128];
+
+	std::map<std::string, TaskData>::iterator it;
+	FOR_EACH(task_data,it)
+	{
+		TaskData& d=it->second;
+		snprintf(str,sizeof(str),"%s: %2.2f/%2.2f ms x%d",it->first.c_str(),d.time,d.time_max,d.count_last);
+		terRenderDevice->OutText(pos.x,pos.y,str,sColor4f(1,1,1,1));
+		pos.y+=height;
+	}
+}
+
 int LagStatistic::CalcDTime()
 {
 	float lag_quant,net_skip,net_wait;
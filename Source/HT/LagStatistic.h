@@ -13,6 +13,8 @@ public:
 	void NextLogicQuant();
 	void Show();
 
+	void AddTaskTime(const char* name, float time);//Время задания JobPool (мс), из любого потока
+
 	int CalcDTime();//return ms
 protected:
 	MTSection lock_lag;
@@ -30,7 +32,17 @@ protected:
 	QuantData cur_data;
 	std::list<QuantData> list_data;
 
+	struct TaskData
+	{
+		float time;//среднее, мс
+		float time_max;
+		int count;//с последнего кванта
+		int count_last;
+	};
+	std::map<std::string, TaskData> task_data;
+
 	void ShowAverage(Vect2i pos,int interval);
+	void ShowTasks(Vect2i pos);
 	void CalcAverage(int interval,float& lag_quant,float& net_skip,float& net_wait);
 
 	void clear();
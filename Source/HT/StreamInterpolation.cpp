@@ -22,15 +22,16 @@ StreamInterpolator stream_interpolator;
 
 StreamInterpolator::StreamInterpolator()
 {
-	MTINIT(lock);
+	write_index=0;
+	ready_=1;
+	read_index=2;
 	in_avatar=false;
-    stream.automatic_realloc = true;
 }
 
 StreamInterpolator::~StreamInterpolator()
 {
-    ClearData();
-	MTDONE(lock);
+	for(Frame& frame : frames)
+		frame.clear();
 }
 
 bool StreamInterpolator::set(InterpolateFunction func,cUnknownClass* obj)
@@ -54,16 +55,15 @@ bool StreamInterpolator::set(InterpolateFunction func,cUnknownClass* obj)
 #endif
     xassert(in_avatar);
 	xassert(sizeof(func)==sizeof(InterpolateFunction));
-    last_header = stream.tell();
-    stream.write(data);
-    headers_count += 1;
+    Frame& frame = frames[write_index];
+    frame.last_header = frame.stream.tell();
+    frame.stream.write(data);
+    frame.headers_count += 1;
 	return true;
 }
 
-void StreamInterpolator::ClearData()
+void StreamInterpolator::Frame::clear()
 {
-    Lock();
-
     if (headers_count) {
         size_t size = stream.tell();
         stream.set(0);
@@ -88,17 +88,10 @@ void StreamInterpolator::ClearData()
         headers_count = 0;
         last_header = 0;
     }
-
-    Unlock();
 }
 
-void StreamInterpolator::ProcessData()
+void StreamInterpolator::Frame::process()
 {
-    MTG();
-	Lock();
-	timer=HTManager::instance()->interpolationFactor();
-	timer_=1-timer;
-    
     if (headers_count) {
         size_t size = stream.tell();
         stream.set(0);
@@ -127,8 +120,56 @@ void StreamInterpolator::ProcessData()
         xassert(headers == headers_count);
         xassert(stream.tell() == size);
     }
+}
+
+void StreamInterpolator::publish()
+{
+	//acq_rel: содержимое кадра станет видно графике вместе с индексом
+	int prev=ready_.exchange(write_index | FRAME_FRESH, std::memory_order_acq_rel);
+	//Назад приходит либо не прочитанный кадр, либо отданный графикой
+	write_index=prev & FRAME_INDEX_MASK;
+}
+
+void StreamInterpolator::BeginFrame()
+{
+	MTL();
+	frames[write_index].clear();
+	in_avatar=true;
+}
+
+void StreamInterpolator::PublishFrame()
+{
+	MTL();
+	in_avatar=false;
+	publish();
+}
+
+void StreamInterpolator::ClearData()
+{
+	//Графика стоит (однопоточный режим, закрытие игры) - чистим все буферы
+	if(MT_IS_GRAPH()){
+		for(Frame& frame : frames)
+			frame.clear();
+		return;
+	}
+
+	//Иначе публикуем пустой кадр, графика перестанет рисовать старый
+	frames[write_index].clear();
+	publish();
+	frames[write_index].clear();
+}
+
+void StreamInterpolator::ProcessData()
+{
+    MTG();
+	timer=HTManager::instance()->interpolationFactor();
+	timer_=1-timer;
+
+	//Забираем свежий кадр, если логика успела его опубликовать
+	if(ready_.load(std::memory_order_relaxed) & FRAME_FRESH)
+		read_index=ready_.exchange(read_index, std::memory_order_acq_rel) & FRAME_INDEX_MASK;
 
-	Unlock();
+	frames[read_index].process();
 }
 
 /////////////////////////////////////////////////////////////
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 #define STREAM_INTERPOLATOR_USE_HANDLES
 
 /*
@@ -37,34 +39,59 @@ struct sAngleInterpolate
 	eAxis axis;
 };
 
+/*
+Тройная буферизация без блокировок.
+Логика пишет кадр в frames[write_index] и публикует его обменом ready_,
+графика забирает последний опубликованный кадр обменом ready_ на свой
+frames[read_index]. Третий буфер всегда лежит в ready_, поэтому ни одна
+сторона не ждет другую.
+*/
 class StreamInterpolator
 {
-	XBuffer stream;
-    size_t last_header = 0;
-    size_t headers_count = 0;
-	MTDECLARE(lock);
+	struct Frame
+	{
+		XBuffer stream;
+		size_t last_header = 0;
+		size_t headers_count = 0;
+
+		Frame() { stream.automatic_realloc = true; }
+		void clear();
+		void process();
+	};
+
+	enum {
+		FRAME_INDEX_MASK = 3,
+		FRAME_FRESH = 4 //В ready_ лежит еще не прочитанный графикой кадр
+	};
+
+	Frame frames[3];
+	int write_index; //Только логика
+	int read_index; //Только графика
+	std::atomic<int> ready_;
 	bool in_avatar;
+
+	void publish();
 public:
 	StreamInterpolator();
 	~StreamInterpolator();
 	void ProcessData();
 	void ClearData();
 
-	void Lock(){MTENTER(lock);};
-	void Unlock(){MTLEAVE(lock);};
-
-	void SetInAvatar(bool in){in_avatar=in;}
+	//Начало и публикация кадра интерполяции, логический поток
+	void BeginFrame();
+	void PublishFrame();
 
 	bool set(InterpolateFunction func,cUnknownClass* obj);
 
     template<typename T>
     StreamInterpolator& write(const T& v) {
+        Frame& frame = frames[write_index];
         //Increment data len with data about to write
-        InterpolateHeader& data = *reinterpret_cast<InterpolateHeader*>(&stream[last_header]);
+        InterpolateHeader& data = *reinterpret_cast<InterpolateHeader*>(&frame.stream[frame.last_header]);
         xassert(data.data_len + sizeof(T) <= std::numeric_limits<uint16_t>().max());
         data.data_len += sizeof(T);
         //Write data
-        stream.write(v);
+        frame.stream.write(v);
         return *this;
     }
     
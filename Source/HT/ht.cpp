@@ -5,6 +5,7 @@
 #include "GenericControls.h"
 #include "Config.h"
 #include "LagStatistic.h"
+#include "JobPool.h"
 #include <cstdlib>
 #include <sstream>
 #include <thread>
@@ -36,6 +37,16 @@ namespace MTConfig {
 #ifndef EMSCRIPTEN
         xassert(mtValue == -1);
         mtValue = value ? 1 : 0;
+#endif
+    }
+
+    int logicWorkersValue = 0;
+    int logicWorkers() {
+        return logicWorkersValue;
+    }
+    void setLogicWorkers(int value) {
+#ifndef EMSCRIPTEN
+        logicWorkersValue = std::max(value, 0);
 #endif
     }
 }
@@ -43,7 +54,16 @@ namespace MTConfig {
 HTManager* HTManager::self=nullptr;
 HTManager::HTManager()
 {
+	trace_thread_name("graphics");
+	if(check_command_line("trace"))
+		trace_enable(true);
+
 	lag_stat=new LagStatistic;
+	job_pool=nullptr;
+	if(MTConfig::logicWorkers()){
+		job_pool=new JobPool(MTConfig::logicWorkers());
+		job_pool->setLagStatistic(lag_stat);
+	}
 	logic_thread_id=bad_thread_id;
 	restartGame_ = false;
 	
@@ -65,8 +85,11 @@ HTManager::HTManager()
 HTManager::~HTManager()
 {
     MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+	if(trace_enabled())
+		trace_dump();
 	done();
 	self=nullptr;
+	delete job_pool;
 	delete lag_stat;
 }
 
@@ -95,6 +118,15 @@ void HTManager::GameStart(const MissionDescription& mission)
         MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
         gameShell->GameStart(mission);
         MT_SET_TYPE(MT_GRAPH_THREAD);
+        startLogic();
+
+#ifdef GPX
+    gpx()->sdk4()->interstitialAd();
+#endif
+}
+
+void HTManager::startLogic()
+{
         syncro_timer.skip();
         syncro_timer.next_frame();
         time = syncro_timer();
@@ -109,16 +141,10 @@ void HTManager::GameStart(const MissionDescription& mission)
                 SDL_DetachThread(thread);
             }
         }
-
-#ifdef GPX
-    gpx()->sdk4()->interstitialAd();
-#endif
 }
 
-void HTManager::GameClose()
+void HTManager::stopLogic()
 {
-        MTG();
-        MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
         if (MTConfig::multithreading() && logic_thread_id != bad_thread_id) {
             end_logic = SDL_CreateSemaphore(0);
 
@@ -129,7 +155,13 @@ void HTManager::GameClose()
             end_logic = nullptr;
             logic_thread_id = bad_thread_id;
         }
+}
 
+void HTManager::GameClose()
+{
+        MTG();
+        MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+        stopLogic();
         gameShell->GameClose();
         MT_SET_TYPE(MT_GRAPH_THREAD);
 
@@ -138,6 +170,55 @@ void HTManager::GameClose()
 #endif
 }
 
+bool HTManager::seekReplay(unsigned int quant)
+{
+	MTG();
+	if(!universe() || !universe()->flag_rePlayReel)
+		return false;
+
+	MT_SET_TYPE(MT_LOGIC_THREAD | MT_GRAPH_THREAD);
+	stopLogic();
+
+	terHyperSpace* space = universe();
+	quant = std::min(quant, static_cast<unsigned int>(space->endQuant_inReplayListGameCommands));
+	const terHyperSpace::ReplayKeyframe* keyframe = space->findReplayKeyframe(quant);
+	unsigned int current = space->getCurrentGameQuant();
+
+	//Вперед без более близкого кадра - просто досчитываем
+	if(quant < current || (keyframe && keyframe->quant > current)){
+		MissionDescription mission(gameShell->CurrentMission.playReelPath().c_str(), GT_PLAY_RELL);
+		if(keyframe && !space->loadReplayKeyframe(*keyframe, mission))
+			keyframe = nullptr;
+		unsigned int start = keyframe ? keyframe->quant : 0;
+
+		//Снятые по ходу проигрывания кадры переносятся в новую вселенную
+		std::list<terHyperSpace::ReplayKeyframe> keyframes;
+		keyframes.swap(space->replayKeyframes);
+		CameraCoordinate camera = terCamera->coordinate();
+		float speed = gameShell->getSpeed();
+
+		gameShell->GameClose();
+		gameShell->GameStart(mission);
+
+		space = universe();
+		if(keyframes.size() >= space->replayKeyframes.size())
+			space->replayKeyframes.swap(keyframes);
+		if(start)
+			space->setReplayPosition(start);
+		terCamera->setCoordinate(camera);
+		gameShell->setSpeed(speed);
+	}
+
+	while(universe()->getCurrentGameQuant() < quant){
+		if(!LogicQuantUnpaced())
+			break;
+	}
+
+	MT_SET_TYPE(MT_GRAPH_THREAD);
+	startLogic();
+	return true;
+}
+
 void HTManager::logic_thread()
 {
     SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
@@ -159,6 +240,7 @@ void HTManager::logic_thread()
     if (check_command_line("dump_mt_tls")) {
         debug_dump_mt_tls();
     }
+    trace_thread_name("logic");
 
 	while(end_logic== nullptr)
 	{
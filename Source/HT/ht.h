@@ -29,6 +29,12 @@ public:
 	void GameStart(const MissionDescription& mission);
 	void GameClose();
 
+	//Перемотка проигрываемой записи: ближайший предшествующий ключевой кадр и досчет до quant
+	bool seekReplay(unsigned int quant);
+
+	//Логический квант без синхронизации по времени и без графики - для замеров
+	bool LogicQuantUnpaced();
+
 	float interpolationFactor() const { return interpolation_factor_; }
 
 	MTSection* GetLockDeleteUnit(){return &lock_delete;};
@@ -59,6 +65,8 @@ protected:
 
 	SDL_threadID logic_thread_id;
 	void logic_thread();
+	void startLogic();
+	void stopLogic();
 
     friend int logic_thread_init(void*);
 
@@ -82,6 +90,7 @@ protected:
 	MTSection lock_delete;
 
 	class LagStatistic* lag_stat;
+	class JobPool* job_pool;
 };
 
 /*
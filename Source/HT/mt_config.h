@@ -8,6 +8,9 @@
 namespace MTConfig {
     bool multithreading();
     void setMultithreading(bool);
+    //Дополнительные потоки для параллельных фаз логики, 0 - выключено
+    int logicWorkers();
+    void setLogicWorkers(int);
 };
 
 #endif //PERIMETER_HT_CONFIG_H
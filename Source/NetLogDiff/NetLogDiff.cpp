@@ -0,0 +1,291 @@
+// netlogdiff - разбор бинарных дампов сетевого лога (netlog.bin из desync_<игра>_<netid> каждого клиента)
+//
+//	netlogdiff <dump>			- вывести лог текстом "имя: значение" по квантам
+//	netlogdiff <dump0> <dump1>	- найти первое расхождение и показать контекст
+//
+// Формат - Source/Util/NetLogFormat.h, записи пишет log_var в Source/Util/DebugUtil.h
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "../Util/NetLogFormat.h"
+
+static const int CONTEXT_RECORDS = 20;
+
+struct Record
+{
+	uint32_t site;
+	std::string value; //сырые байты с тегом - сравниваются как есть
+};
+
+struct Quant
+{
+	int32_t quant;
+	std::vector<Record> records;
+};
+
+struct NetLog
+{
+	std::string header; //текст перед бинарной частью
+	std::unordered_map<uint32_t, std::string> sites;
+	std::vector<Quant> quants;
+};
+
+class Reader
+{
+	const std::string& data_;
+	size_t offset_;
+public:
+	Reader(const std::string& data, size_t offset) : data_(data), offset_(offset) {}
+
+	size_t tell() const { return offset_; }
+	bool bytes(void* out, size_t size) {
+		if(offset_ + size > data_.size())
+			return false;
+		memcpy(out, data_.data() + offset_, size);
+		offset_ += size;
+		return true;
+	}
+	template<class T> bool read(T& v) { return bytes(&v, sizeof(T)); }
+	bool skip(size_t size) {
+		if(offset_ + size > data_.size())
+			return false;
+		offset_ += size;
+		return true;
+	}
+};
+
+static bool valueSize(Reader& in, uint8_t type, size_t& size)
+{
+	uint16_t len;
+	switch(type){
+		case NET_LOG_INT32: case NET_LOG_UINT32: case NET_LOG_FLOAT: size = 4; return true;
+		case NET_LOG_INT64: case NET_LOG_UINT64: case NET_LOG_DOUBLE: size = 8; return true;
+		case NET_LOG_VECT3F: size = 12; return true;
+		case NET_LOG_QUATF: size = 16; return true;
+		case NET_LOG_STRING: case NET_LOG_RAW:
+			if(!in.read(len))
+				return false;
+			size = len;
+			return true;
+	}
+	return false;
+}
+
+static bool loadLog(const char* path, NetLog& log)
+{
+	FILE* file = fopen(path, "rb");
+	if(!file){
+		fprintf(stderr, "%s: can't open\n", path);
+		return false;
+	}
+	std::string data;
+	char chunk[65536];
+	size_t n;
+	while((n = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		data.append(chunk, n);
+	fclose(file);
+
+	size_t start = std::string::npos;
+	for(size_t i = 0; i + 8 <= data.size(); i++){
+		uint32_t magic, version;
+		memcpy(&magic, data.data() + i, 4);
+		memcpy(&version, data.data() + i + 4, 4);
+		if(magic == NET_LOG_DUMP_MAGIC && version == NET_LOG_DUMP_VERSION){
+			start = i;
+			break;
+		}
+	}
+	if(start == std::string::npos){
+		fprintf(stderr, "%s: not a binary net log\n", path);
+		return false;
+	}
+	log.header = data.substr(0, start);
+
+	Reader in(data, start + 8);
+	uint32_t sites;
+	if(!in.read(sites))
+		goto broken;
+	for(uint32_t i = 0; i < sites; i++){
+		uint32_t id;
+		uint16_t len;
+		if(!in.read(id) || !in.read(len))
+			goto broken;
+		std::string name(len, '\0');
+		if(!in.bytes(&name[0], len))
+			goto broken;
+		log.sites[id] = name;
+	}
+
+	uint32_t quants;
+	if(!in.read(quants))
+		goto broken;
+	log.quants.resize(quants);
+	for(Quant& quant : log.quants){
+		uint32_t size;
+		if(!in.read(quant.quant) || !in.read(size))
+			goto broken;
+		size_t end = in.tell() + size;
+		if(end > data.size())
+			goto broken;
+		while(in.tell() < end){
+			Record record;
+			uint8_t type;
+			size_t begin, value_size;
+			if(!in.read(record.site))
+				goto broken;
+			begin = in.tell();
+			if(!in.read(type) || !valueSize(in, type, value_size) || !in.skip(value_size) || in.tell() > end)
+				goto broken;
+			record.value = data.substr(begin, in.tell() - begin);
+			quant.records.push_back(record);
+		}
+	}
+	return true;
+
+broken:
+	fprintf(stderr, "%s: truncated or corrupted at %zu\n", path, in.tell());
+	return false;
+}
+
+static std::string formatValue(const std::string& value)
+{
+	char buf[128];
+	const char* p = value.data() + 1;
+	int32_t i32; int64_t i64; uint32_t u32; uint64_t u64; float f[4]; double d; uint16_t len;
+	switch(static_cast<uint8_t>(value[0])){
+		case NET_LOG_INT32: memcpy(&i32, p, 4); snprintf(buf, sizeof(buf), "%" PRId32, i32); break;
+		case NET_LOG_INT64: memcpy(&i64, p, 8); snprintf(buf, sizeof(buf), "%" PRId64, i64); break;
+		case NET_LOG_UINT32: memcpy(&u32, p, 4); snprintf(buf, sizeof(buf), "%" PRIu32, u32); break;
+		case NET_LOG_UINT64: memcpy(&u64, p, 8); snprintf(buf, sizeof(buf), "%" PRIu64, u64); break;
+		case NET_LOG_FLOAT: memcpy(f, p, 4); snprintf(buf, sizeof(buf), "%.9g", f[0]); break;
+		case NET_LOG_DOUBLE: memcpy(&d, p, 8); snprintf(buf, sizeof(buf), "%.17g", d); break;
+		case NET_LOG_VECT3F: memcpy(f, p, 12); snprintf(buf, sizeof(buf), "%.9g  %.9g  %.9g", f[0], f[1], f[2]); break;
+		case NET_LOG_QUATF: memcpy(f, p, 16); snprintf(buf, sizeof(buf), "%.9g   %.9g  %.9g  %.9g", f[0], f[1], f[2], f[3]); break;
+		case NET_LOG_STRING:
+			return value.substr(3);
+		case NET_LOG_RAW: {
+			memcpy(&len, p, 2);
+			std::string hex;
+			for(size_t j = 3; j < value.size(); j++){
+				snprintf(buf, sizeof(buf), "%02x", static_cast<uint8_t>(value[j]));
+				hex += buf;
+			}
+			return hex;
+		}
+		default:
+			return "?";
+	}
+	return buf;
+}
+
+static std::string formatRecord(const NetLog& log, const Record& record)
+{
+	auto i = log.sites.find(record.site);
+	std::string name;
+	if(i != log.sites.end())
+		name = i->second;
+	else{
+		char buf[32];
+		snprintf(buf, sizeof(buf), "site %08x", record.site);
+		name = buf;
+	}
+	return name + ": " + formatValue(record.value);
+}
+
+static void printLog(const NetLog& log)
+{
+	fwrite(log.header.data(), 1, log.header.size(), stdout);
+	for(const Quant& quant : log.quants){
+		printf("=== quant %d\n", quant.quant);
+		for(const Record& record : quant.records)
+			printf("%s\n", formatRecord(log, record).c_str());
+	}
+}
+
+struct Position
+{
+	const Quant* quant;
+	int record;
+};
+
+static int diffLogs(const NetLog& log0, const NetLog& log1)
+{
+	//Дампы снимаются в разные моменты - сравниваем только общие кванты
+	std::unordered_map<int32_t, const Quant*> quants1;
+	for(const Quant& quant : log1.quants)
+		quants1[quant.quant] = &quant;
+
+	int common = 0;
+	std::vector<Position> history;
+	for(const Quant& q0 : log0.quants){
+		auto found = quants1.find(q0.quant);
+		if(found == quants1.end())
+			continue;
+		const Quant& q1 = *found->second;
+		common++;
+		size_t count = std::max(q0.records.size(), q1.records.size());
+		for(size_t i = 0; i < count; i++){
+			bool has0 = i < q0.records.size(), has1 = i < q1.records.size();
+			if(has0 && has1 && q0.records[i].site == q1.records[i].site && q0.records[i].value == q1.records[i].value){
+				history.push_back({&q0, static_cast<int>(i)});
+				continue;
+			}
+
+			printf("First difference: quant %d, record %zu\n\n", q0.quant, i);
+			size_t first = history.size() > CONTEXT_RECORDS ? history.size() - CONTEXT_RECORDS : 0;
+			int last_quant = -1;
+			for(size_t j = first; j < history.size(); j++){
+				const Quant& q = *history[j].quant;
+				if(q.quant != last_quant)
+					printf("=== quant %d\n", last_quant = q.quant);
+				printf("  %s\n", formatRecord(log0, q.records[history[j].record]).c_str());
+			}
+			if(q0.quant != last_quant)
+				printf("=== quant %d\n", q0.quant);
+			for(size_t j = i; j < i + CONTEXT_RECORDS && j < count; j++){
+				std::string text0 = j < q0.records.size() ? formatRecord(log0, q0.records[j]) : "<end of quant>";
+				std::string text1 = j < q1.records.size() ? formatRecord(log1, q1.records[j]) : "<end of quant>";
+				if(text0 == text1 && j < q0.records.size() && j < q1.records.size() && q0.records[j].value == q1.records[j].value)
+					printf("  %s\n", text0.c_str());
+				else
+					printf("< %s\n> %s\n", text0.c_str(), text1.c_str());
+			}
+			return 1;
+		}
+	}
+
+	if(!common){
+		printf("No common quants\n");
+		return 2;
+	}
+	printf("No differences in %d common quants\n", common);
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2 || argc > 3){
+		fprintf(stderr, "Usage: netlogdiff <dump> [<other dump>]\n");
+		return 2;
+	}
+
+	NetLog log0;
+	if(!loadLog(argv[1], log0))
+		return 2;
+	if(argc == 2){
+		printLog(log0);
+		return 0;
+	}
+
+	NetLog log1;
+	if(!loadLog(argv[2], log1))
+		return 2;
+	return diffLogs(log0, log1);
+}
@@ -13,6 +13,8 @@
 #include "GameContent.h"
 #include "codepages/codepages.h"
 #include "qd_textdb.h"
+#include "../HT/ht.h"
+#include "../Util/Tracing.h"
 
 bool net_log_mode=0;
 XBuffer net_log_buffer(8192, 1);
@@ -32,6 +34,8 @@ const char * KEY_REPLAY_REEL="replay";
 
 #define FILE_REPLAY_MAGIC_LEN 20
 static const char filePlayReelID[FILE_REPLAY_MAGIC_LEN] = "PerimeterReplay002\0";
+//С ключевыми кадрами: после описания миссии - размер и блок команд, затем кадры
+static const char filePlayReelKeyframesID[FILE_REPLAY_MAGIC_LEN] = "PerimeterReplay003\0";
 
 #ifdef PERIMETER_DEBUG
 class cMonowideFont {
@@ -54,10 +58,14 @@ public:
 cMonowideFont* pMonowideFont;
 #endif //PERIMETER_DEBUG
 
-bool checkPlayReelMagic(XStream& fi) {
+bool checkPlayReelMagic(XStream& fi, bool* keyframes = nullptr) {
     char magic[FILE_REPLAY_MAGIC_LEN];
     fi.read(&magic, FILE_REPLAY_MAGIC_LEN);
-    return strncmp(filePlayReelID, magic, FILE_REPLAY_MAGIC_LEN) == 0;
+    bool with_keyframes = strncmp(filePlayReelKeyframesID, magic, FILE_REPLAY_MAGIC_LEN) == 0;
+    if (keyframes) {
+        *keyframes = with_keyframes;
+    }
+    return with_keyframes || strncmp(filePlayReelID, magic, FILE_REPLAY_MAGIC_LEN) == 0;
 }
 
 terHyperSpace::terHyperSpace(PNetCenter* net_client, MissionDescription& mission)
@@ -148,6 +156,15 @@ terHyperSpace::terHyperSpace(PNetCenter* net_client, MissionDescription& mission
 	}
 	flag_autoSavePlayReel = IniManager("Perimeter.ini").getInt("Game","AutoSavePlayReel") != 0;
 
+	//Ключевые кадры только по явной настройке: снимок задерживает квант и берется из логического
+	//потока без lock_logic. В сетевой игре квант задерживается у всех игроков - там только ключ.
+	//Период в квантах, 3000 - 5 минут игры
+	int keyframe_period = 0;
+	if(!pNetCenter)
+		IniManager("Perimeter.ini", false).getInt("Game", "ReplayKeyframePeriod", keyframe_period);
+	check_command_line_parameter("replay_keyframes", keyframe_period);
+	replayKeyframePeriod = std::max(keyframe_period, 0);
+
 	currentQuant=0;
 	//flag_endCurQuant=0;
 
@@ -170,13 +187,18 @@ void getMissionDescriptionInThePlayReelFile(const char* fname, MissionDescriptio
 {
 	XStream fi(convert_path_content(fname).c_str(), XS_IN);
 
-	if(!checkPlayReelMagic(fi)) ErrH.Abort("Incorrect play reel file!:", XERR_USER, 0, fname);
+	bool keyframes;
+	if(!checkPlayReelMagic(fi, &keyframes)) ErrH.Abort("Incorrect play reel file!:", XERR_USER, 0, fname);
 
 	int sizeOtherData=fi.size()-fi.tell();
 	XBuffer mdBuf(sizeOtherData);
 	fi.read(mdBuf.address(), sizeOtherData);
 	md.read(mdBuf);
 
+	if(keyframes){
+		uint32_t commandsSize;
+		mdBuf.read(&commandsSize, sizeof(commandsSize));
+	}
 	unsigned int quantAmount;
 	mdBuf.read(&quantAmount, sizeof(quantAmount));
 }
@@ -191,8 +213,8 @@ bool isCorrectPlayReelFile(const char* fname)
 }
 
 size_t terHyperSpace::serializeGameCommands(XBuffer& out) const {
-    //Store the accumulated quants from replay + current one
-    unsigned int quants = endQuant_inReplayListGameCommands + lastQuant_inFullListGameCommands;
+    //Store the accumulated quants from replay + current one, when replaying the reel commands already cover everything
+    unsigned int quants = flag_rePlayReel ? endQuant_inReplayListGameCommands : endQuant_inReplayListGameCommands + lastQuant_inFullListGameCommands;
     size_t result = out.write(&quants, sizeof(quants));
 
     InOutNetComBuffer out_buffer(1024, true);
@@ -284,7 +306,8 @@ bool terHyperSpace::loadPlayReel(const char* fname)
 {
 	XStream fi(convert_path_content(fname), XS_IN);
 
-	if(!checkPlayReelMagic(fi)) ErrH.Abort("Incorrect play reel file!:", XERR_USER, 0, fname);
+	bool keyframes;
+	if(!checkPlayReelMagic(fi, &keyframes)) ErrH.Abort("Incorrect play reel file!:", XERR_USER, 0, fname);
 
 	size_t sizeOtherData=fi.size()-fi.tell();
 	XBuffer buf(sizeOtherData, true);
@@ -293,8 +316,26 @@ bool terHyperSpace::loadPlayReel(const char* fname)
 	MissionDescription temp;
 	temp.read(buf);
     
-    size_t sizePlayReelData = sizeOtherData - buf.tell();
-    deserializeGameCommands(buf, sizePlayReelData);
+    if (keyframes) {
+        uint32_t commandsSize;
+        buf > commandsSize;
+        size_t commandsEnd = buf.tell() + commandsSize;
+        deserializeGameCommands(buf, commandsSize);
+        buf.set(commandsEnd);
+
+        uint32_t count;
+        buf > count;
+        CAutoLock lock(m_FullListGameCommandLock);
+        replayKeyframes.clear();
+        for (uint32_t i = 0; i < count && buf.tell() < sizeOtherData; i++) {
+            replayKeyframes.emplace_back();
+            ReplayKeyframe& keyframe = replayKeyframes.back();
+            buf > keyframe.quant > keyframe.data;
+        }
+    } else {
+        size_t sizePlayReelData = sizeOtherData - buf.tell();
+        deserializeGameCommands(buf, sizePlayReelData);
+    }
 
 	curRePlayPosition=replayListGameCommands.begin();
 	return true;
@@ -309,7 +350,11 @@ terHyperSpace::SAVE_REPLAY_RESULT terHyperSpace::savePlayReel(const char* fname)
 		return SAVE_REPLAY_RW_ERROR;
 	}
 
-	fo.write(&filePlayReelID, sizeof(filePlayReelID));
+	//Кадры пишутся под замком - логика может добавлять новые
+	CAutoLock lock(m_FullListGameCommandLock);
+	bool keyframes = !replayKeyframes.empty();
+
+	fo.write(keyframes ? filePlayReelKeyframesID : filePlayReelID, FILE_REPLAY_MAGIC_LEN);
 	if (fo.ioError()) {
 		return SAVE_REPLAY_RW_ERROR_OR_DISK_FULL;
 	}
@@ -330,7 +375,21 @@ terHyperSpace::SAVE_REPLAY_RESULT terHyperSpace::savePlayReel(const char* fname)
     //Write game commands
     buf.init();
     serializeGameCommands(buf);
+    if (keyframes) {
+        uint32_t commandsSize = buf.tell();
+        fo.write(&commandsSize, sizeof(commandsSize));
+    }
     fo.write(buf.address(), buf.tell());
+
+    //Write keyframes
+    if (keyframes) {
+        buf.init();
+        buf < static_cast<uint32_t>(replayKeyframes.size());
+        for (auto& keyframe : replayKeyframes) {
+            buf < keyframe.quant < keyframe.data;
+        }
+        fo.write(buf.address(), buf.tell());
+    }
     
     if (fo.ioError()) {
         return SAVE_REPLAY_RW_ERROR_OR_DISK_FULL;
@@ -372,6 +431,104 @@ void terHyperSpace::allSavePlayReel()
 	}
 }
 
+unsigned int terHyperSpace::reelQuant() const
+{
+	//Команды проигрываемой записи уже в ее нумерации, записываемые идут после команд сохранения
+	return flag_rePlayReel ? currentQuant : endQuant_inReplayListGameCommands + currentQuant;
+}
+
+void terHyperSpace::saveReplayKeyframe()
+{
+	if(!replayKeyframePeriod || flag_stopSavePlayReel)
+		return;
+	unsigned int quant = reelQuant();
+	if(quant % replayKeyframePeriod)
+		return;
+	{
+		//Lock!
+		CAutoLock lock(m_FullListGameCommandLock);
+		//Кадры только дописываются в конец: при проигрывании записи с кадрами или после перемотки назад уже есть
+		if(!replayKeyframes.empty() && replayKeyframes.back().quant >= quant)
+			return;
+	}
+
+	trace_scope(saveReplayKeyframe);
+
+	MissionDescription mission(gameShell->CurrentMission);
+	mission.setSaveName("");
+	mission.globalTime = global_time();
+	{
+		//Вызывается из логического потока - здесь только снимается проверка потока, без lock_logic,
+		//поэтому кадр не читает состояние интерфейса (universalSave с keyframe)
+		MTAutoSingleThread single_thread;
+		if(!universe()->universalSave(mission, true, true))
+			return;
+	}
+
+	//binaryData уже сжата в universalSave, отдельно сжимается только текст SavePrm.
+	//Скрипты не пишутся - при перемотке остаются от миссии записи
+	std::list<ReplayKeyframe> added(1);
+	ReplayKeyframe& keyframe = added.back();
+	keyframe.quant = quant;
+	XBuffer saveData(0, true);
+	if(mission.saveData.compress(saveData) != 0)
+		return;
+	mission.saveData.alloc(0);
+	mission.scriptsData.alloc(0);
+	keyframe.data < saveData;
+	mission.write(keyframe.data);
+
+	//Lock!
+	CAutoLock lock(m_FullListGameCommandLock);
+	replayKeyframes.splice(replayKeyframes.end(), added);
+}
+
+const terHyperSpace::ReplayKeyframe* terHyperSpace::findReplayKeyframe(unsigned int quant) const
+{
+	//Lock!
+	CAutoLock lock(m_FullListGameCommandLock);
+	const ReplayKeyframe* found = nullptr;
+	for(auto& keyframe : replayKeyframes){
+		if(keyframe.quant <= quant && (!found || found->quant < keyframe.quant))
+			found = &keyframe;
+	}
+	return found;
+}
+
+bool terHyperSpace::loadReplayKeyframe(const ReplayKeyframe& keyframe, MissionDescription& mission) const
+{
+	XBuffer data(keyframe.data.address(), keyframe.data.tell());
+	XBuffer saveData(0, true);
+	data > saveData;
+
+	XBuffer scriptsData(0, true);
+	std::swap(scriptsData, mission.scriptsData);
+	mission.clearData();
+	mission.read(data);
+	std::swap(scriptsData, mission.scriptsData);
+
+	saveData.set(0);
+	if(saveData.uncompress(mission.saveData) != 0)
+		return false;
+	mission.saveData.realloc(mission.saveData.tell());
+	mission.saveData.set(0);
+	return true;
+}
+
+void terHyperSpace::setReplayPosition(unsigned int quant)
+{
+	xassert(flag_rePlayReel && !currentQuant);
+	currentQuant = quant;
+	lastQuant_inFullListGameCommands = quant;
+	lastRealizedQuant = quant;
+	allowedRealizingQuant = quant + 1;
+
+	//Команды до кадра уже учтены в его состоянии
+	curRePlayPosition = replayListGameCommands.begin();
+	while(curRePlayPosition != replayListGameCommands.end() && (*curRePlayPosition)->curCommandQuant_ <= quant)
+		++curRePlayPosition;
+}
+
 terHyperSpace::~terHyperSpace()
 {
 	//Очистка логов
@@ -479,6 +636,7 @@ bool terHyperSpace::MultiQuant()
 #endif
 
 		logQuant();
+		saveReplayKeyframe();
 
 		lastRealizedQuant=currentQuant;
 		return true;
@@ -633,6 +791,7 @@ bool terHyperSpace::SingleQuant()
 	//конец кванта
 	///unsigned int gridCRC=vMap.getGridCRC(false, currentQuant);
 	log_var(vMap.getGridCRC(false, currentQuant));
+	saveReplayKeyframe();
 
 	allowedRealizingQuant=currentQuant+1;
 
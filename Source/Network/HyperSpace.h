@@ -134,6 +134,25 @@ public:
 	bool flag_stopSavePlayReel;
 	void stopPlayReel() { flag_stopSavePlayReel=true; }
 
+	//Ключевые кадры записи - сжатый текст SavePrm и MissionDescription (без скриптов) с сохранением после кванта quant.
+	//Перемотка грузит ближайший предшествующий кадр и досчитывает остаток кванта за квантом.
+	struct ReplayKeyframe
+	{
+		unsigned int quant;
+		XBuffer data;
+		ReplayKeyframe() : quant(0), data(0, true) {}
+	};
+	std::list<ReplayKeyframe> replayKeyframes;
+	unsigned int replayKeyframePeriod; //в квантах, 0 - не снимать; в сетевой игре по умолчанию 0
+
+	//Номер кванта в нумерации записи (после загрузки сохранения отсчет продолжается)
+	unsigned int reelQuant() const;
+	const ReplayKeyframe* findReplayKeyframe(unsigned int quant) const;
+	//mission - текущая миссия записи, дополняется состоянием кадра
+	bool loadReplayKeyframe(const ReplayKeyframe& keyframe, MissionDescription& mission) const;
+	//Сразу после загрузки из кадра: продолжить проигрывание с кванта кадра
+	void setReplayPosition(unsigned int quant);
+
 
 	MissionDescription curMission;
 
@@ -189,9 +208,14 @@ public:
 			else break;
 		}
 	}
+	//Бинарный дамп для netlogdiff: заголовок, таблица мест вызова, логи по квантам
 	void writeLogList2Buffer(XBuffer& buf){
+		buf < NET_LOG_DUMP_MAGIC < NET_LOG_DUMP_VERSION;
+		net_log_write_sites(buf);
+		buf < static_cast<uint32_t>(logList.size());
 		std::list<sLogElement>::iterator p;
 		for(p=logList.begin(); p!=logList.end(); p++){
+			buf < static_cast<int32_t>(p->quant) < static_cast<uint32_t>(p->pLog->tell());
             buf.write(p->pLog->address(), p->pLog->tell());
 		}
 	}
@@ -207,6 +231,7 @@ public:
 
 	void logQuant();
 	void sendLog(unsigned int quant);
+	void saveReplayKeyframe();
 
 	bool flag_HostMigrate;
 
@@ -12,6 +12,7 @@
 #include <SDL.h>
 #include "files/files.h"
 #include "../HT/mt_config.h"
+#include "Tracing.h"
 
 #ifdef _WIN32
 #include <combaseapi.h>
@@ -73,6 +74,7 @@ int InternalServerThreadInit(void* lpParameter)
     HANDLE hSecondThread = netCenter->hSecondThread;
 
     if (MTConfig::multithreading()) {
+        trace_thread_name("network");
         while (netCenter && netCenter->SecondThreadLive()) {
             netCenter->SecondThreadQuant();
         }
@@ -119,6 +121,7 @@ bool PNetCenter::SecondThreadLive() {
 void PNetCenter::SecondThreadQuant()
 {
     xassert(net_thread_id == SDL_ThreadID());
+    uint64_t trace_begin = trace_enabled() ? getPerformanceCounter() : 0;
     CAutoLock* _pLock=new CAutoLock(m_GeneralLock);
     //decoding command
     if(!internalCommandList.empty()){
@@ -350,6 +353,10 @@ void PNetCenter::SecondThreadQuant()
         LLogicQuant();
     }
 
+    //Сон не входит в интервал
+    if (trace_begin) {
+        trace_record("NetServerQuant", trace_begin, getPerformanceCounter());
+    }
 
     if (MTConfig::multithreading()) {
         curTime = clocki();
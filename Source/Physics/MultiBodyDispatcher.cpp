@@ -64,24 +64,202 @@ bool MultiBodyDispatcher::test(RigidBody& b1, RigidBody& b2, const MatXf& Xr1r2,
 	return false;
 }
 
+//////////////////////////////////////////////////////////////
+//	Индексированная двоичная куча
+// items - элементы кучи, pos[item] - позиция элемента в items
+//////////////////////////////////////////////////////////////
+template<class Less>
+class IndexedHeap
+{
+public:
+	IndexedHeap(int* items, int* pos, int size, Less less) : items_(items), pos_(pos), size_(size), less_(less) {}
+
+	int top() const { return items_[0]; }
+
+	void build() {
+		for(int i = 0; i < size_; i++)
+			pos_[items_[i]] = i;
+		for(int i = size_/2 - 1; i >= 0; i--)
+			siftDown(i);
+	}
+
+	void update(int item) {
+		siftUp(pos_[item]);
+		siftDown(pos_[item]);
+	}
+
+private:
+	int* items_;
+	int* pos_;
+	int size_;
+	Less less_;
+
+	void place(int i, int item) {
+		items_[i] = item;
+		pos_[item] = i;
+	}
+
+	void siftUp(int i) {
+		int item = items_[i];
+		while(i > 0){
+			int parent = (i - 1) >> 1;
+			if(!less_(item, items_[parent]))
+				break;
+			place(i, items_[parent]);
+			i = parent;
+		}
+		place(i, item);
+	}
+
+	void siftDown(int i) {
+		int item = items_[i];
+		for(;;){
+			int child = 2*i + 1;
+			if(child >= size_)
+				break;
+			if(child + 1 < size_ && less_(items_[child + 1], items_[child]))
+				child++;
+			if(!less_(items_[child], item))
+				break;
+			place(i, items_[child]);
+			i = child;
+		}
+		place(i, item);
+	}
+};
+
+void MultiBodyDispatcher::link()
+{
+	ContactList::iterator ci;
+	FOR_EACH(contacts, ci){
+		ci->body1->contacts.push_back(&*ci);
+		ci->body2->contacts.push_back(&*ci);
+	}
+}
+
+int MultiBodyDispatcher::findIsland(int contact)
+{
+	while(contact_island[contact] != contact)
+		contact = contact_island[contact] = contact_island[contact_island[contact]];
+	return contact;
+}
+
+void MultiBodyDispatcher::buildIslands()
+{
+	int size = contacts.size();
+	contact_island.resize(size);
+	for(int i = 0; i < size; i++)
+		contact_island[i] = i;
+
+	// resolve() меняет только подвижные тела, через неподвижные острова не связываются
+	for(int i = 0; i < size; i++){
+		const Contact& c = contacts[i];
+		if(!c.body1_unmovable){
+			int a = findIsland(i), b = findIsland(c.body1->contacts.front() - &contacts[0]);
+			contact_island[max(a, b)] = min(a, b);
+		}
+		if(!c.body2_unmovable){
+			int a = findIsland(i), b = findIsland(c.body2->contacts.front() - &contacts[0]);
+			contact_island[max(a, b)] = min(a, b);
+		}
+	}
+
+	// Родитель всегда с меньшим индексом: корень - первый контакт острова,
+	// к моменту обхода i родитель уже заменен номером острова
+	island_begin.clear();
+	for(int i = 0; i < size; i++){
+		if(contact_island[i] == i){
+			contact_island[i] = island_begin.size();
+			island_begin.push_back(0);
+		}
+		else
+			contact_island[i] = contact_island[contact_island[i]];
+		island_begin[contact_island[i]]++;
+	}
+	int offset = 0;
+	for(int& begin : island_begin){
+		int count = begin;
+		begin = offset;
+		offset += count;
+	}
+	island_begin.push_back(size);
+
+	contact_heap.resize(size);
+	contact_heap_pos.resize(size);
+	for(int i = 0; i < size; i++)
+		contact_heap[contact_heap_pos[i] = island_begin[contact_island[i]]++] = i;
+	for(int k = island_begin.size() - 1; k > 0; k--)
+		island_begin[k] = island_begin[k - 1];
+	island_begin[0] = 0;
+}
+
+float MultiBodyDispatcher::contactKey(int contact)
+{
+	// NaN перебор никогда не выбирал
+	float u_n = contacts[contact].normal_velocity();
+	return u_n == u_n ? u_n : FLT_INF;
+}
+
 void MultiBodyDispatcher::resolve()
 {
 	if(contacts.empty())
 		return;
 
+	link();
+	buildIslands();
+
+	int size = contacts.size();
+	contact_keys.resize(size);
+	for(int i = 0; i < size; i++)
+		contact_keys[i] = contactKey(i);
+
+	auto contactLess = [this](int a, int b) {
+		return contact_keys[a] < contact_keys[b] || (contact_keys[a] == contact_keys[b] && a < b);
+	};
+	auto contactHeap = [&](int island) {
+		int begin = island_begin[island];
+		return IndexedHeap<decltype(contactLess)>(&contact_heap[begin], &contact_heap_pos[0], island_begin[island + 1] - begin, contactLess);
+	};
+
+	int islands = island_begin.size() - 1;
+	for(int k = 0; k < islands; k++)
+		contactHeap(k).build();
+
+	auto islandLess = [&](int a, int b) {
+		return contactLess(contact_heap[island_begin[a]], contact_heap[island_begin[b]]);
+	};
+	island_heap.resize(islands);
+	island_heap_pos.resize(islands);
+	for(int k = 0; k < islands; k++)
+		island_heap[k] = k;
+	IndexedHeap<decltype(islandLess)> islandHeap(&island_heap[0], &island_heap_pos[0], islands, islandLess);
+	islandHeap.build();
+
 	for(int i = 0; i < contacts.size()*collision_resolve_iterations_per_contact; i++){
-		float u_n, u_n_min = FLT_INF;
-		Contact* c_min = nullptr;
-		ContactList::iterator ci;
-		FOR_EACH(contacts, ci)
-			if(u_n_min > (u_n = ci->normal_velocity())){
-				u_n_min = u_n;
-				c_min = &*ci;
-				}
-		if(u_n_min > collision_resolve_velocity_tolerance)
+		int island = islandHeap.top();
+		int c_min = contact_heap[island_begin[island]];
+		if(contact_keys[c_min] > collision_resolve_velocity_tolerance)
 			break;
 
-		if (c_min) c_min->resolve();
+		Contact& c = contacts[c_min];
+		c.resolve();
+
+		// Пересчитываются только контакты, которые resolve() сбросил
+		auto contactHeapIsland = contactHeap(island);
+		ContactPtrList::iterator cpi;
+		if(!c.body1_unmovable)
+			FOR_EACH(c.body1->contacts, cpi){
+				int j = *cpi - &contacts[0];
+				contact_keys[j] = contactKey(j);
+				contactHeapIsland.update(j);
+			}
+		if(!c.body2_unmovable)
+			FOR_EACH(c.body2->contacts, cpi){
+				int j = *cpi - &contacts[0];
+				contact_keys[j] = contactKey(j);
+				contactHeapIsland.update(j);
+			}
+		islandHeap.update(island);
     }
 
 	//xassert("Unable to resolve collision" && i < contacts.size()*collision_resolve_iterations_per_contact);
@@ -208,9 +386,6 @@ int Contact::set(float penetration_, const Vect3f& cp1_, const Vect3f& cp2_, Rig
 	normal.z = 0;
 	normal.Normalize();
 
-	body1->contacts.push_back(this);
-	body2->contacts.push_back(this);
-
 	return 1;
 }
 
@@ -6,6 +6,16 @@
 #include "BinaryArchive.h"
 #include "RigidBody.h"
 
+#include <SDL_cpuinfo.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GROUND_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GROUND_NEON
+#include <arm_neon.h>
+#endif
+
 int RigidBody::IDs;
 
 SINGLETON_PRM(RigidBodyPrmLibrary, "RigidBodyPrmLibrary", "Scripts\\RigidBodyPrmLibrary") rigidBodyPrmLibrary;
@@ -83,43 +93,338 @@ void RigidBody::build(const RigidBodyPrm& prmIn, cObjectNodeRoot* geometry_, con
 	penetrationSum_ = 0;
 }
 
+////////////////////////////////////////////////////////
+//			Опрос решетки
+////////////////////////////////////////////////////////
+static const int groundShl = 12;
+
+struct GroundGrid
+{
+	const unsigned char* buffer;
+	int mask_x, mask_y;
+	int shift_y; // GH_SIZE - степень двойки
+};
+
+static GroundGrid groundGrid()
+{
+	GroundGrid grid;
+	grid.buffer = vMap.GVBuf;
+	grid.mask_x = vMap.clip_mask_x_g;
+	grid.mask_y = vMap.clip_mask_y_g;
+	grid.shift_y = 0;
+	while((1u << grid.shift_y) < vMap.GH_SIZE)
+		grid.shift_y++;
+	xassert((1u << grid.shift_y) == vMap.GH_SIZE);
+	return grid;
+}
+
+typedef void (*GroundKernel)(const GroundGrid& grid, const GroundLattice& lattice, GroundStat& stat);
+
+// Итоги в локальных: запись в stat через алиасинг с GVBuf мешает компилятору
+static void groundLatticeScalar(const GroundGrid& grid, const GroundLattice& lattice, GroundStat& stat)
+{
+	int Sz = 0, Sxz = 0, Syz = 0, dz_max = 0, z_max = 0, z_min = 100000, zero_counter = 0;
+
+	int p0x = lattice.p0x, p0y = lattice.p0y, p0z = lattice.p0z;
+	for(int y = -lattice.Dy; y <= lattice.Dy; y++){
+		int px = p0x, py = p0y, pz = p0z;
+		for(int x = -lattice.Dx; x <= lattice.Dx; x++){
+			int zp = pz >> groundShl;
+			int z = grid.buffer[(((py >> (groundShl + kmGrid)) & grid.mask_y) << grid.shift_y) | ((px >> (groundShl + kmGrid)) & grid.mask_x)];
+
+			if(z == 0)
+				zero_counter++;
+			if(z_max < z)
+				z_max = z;
+			if(z_min > z)
+				z_min = z;
+
+			int dz = z - zp;
+			if(dz_max < dz)
+				dz_max = dz;
+
+			Sz += z;
+			Sxz += x*z;
+			Syz += y*z;
+
+			px += lattice.dpx_x;
+			py += lattice.dpx_y;
+			pz += lattice.dpx_z;
+		}
+		p0x += lattice.dpy_x;
+		p0y += lattice.dpy_y;
+		p0z += lattice.dpy_z;
+	}
+
+	stat.Sz = Sz;
+	stat.Sxz = Sxz;
+	stat.Syz = Syz;
+	stat.dz_max = dz_max;
+	stat.z_max = z_max;
+	stat.z_min = z_min;
+	stat.zero_counter = zero_counter;
+}
+
+// Векторные ядра: строка решетки по 4 узла, выборка из GVBuf поэлементная,
+// остаток строки (2Dx+1 не кратно 4) - по одному узлу в нулевой дорожке
+#ifdef GROUND_SSE2
+static inline __m128i max_epi32(__m128i a, __m128i b)
+{
+	__m128i mask = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i min_epi32(__m128i a, __m128i b)
+{
+	__m128i mask = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+static inline int hsum_epi32(__m128i v)
+{
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+static inline int hmax_epi32(__m128i v)
+{
+	v = max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = max_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+static inline int hmin_epi32(__m128i v)
+{
+	v = min_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+	v = min_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(v);
+}
+
+static void groundLatticeSSE2(const GroundGrid& grid, const GroundLattice& lattice, GroundStat& stat)
+{
+	const int n = 2*lattice.Dx + 1;
+	const int blocks = n & ~3;
+	const int dx = lattice.dpx_x, dy = lattice.dpx_y, dz = lattice.dpx_z;
+
+	__m128i lane_x = _mm_setr_epi32(0, dx, 2*dx, 3*dx);
+	__m128i lane_y = _mm_setr_epi32(0, dy, 2*dy, 3*dy);
+	__m128i lane_z = _mm_setr_epi32(0, dz, 2*dz, 3*dz);
+	__m128i step_x = _mm_set1_epi32(4*dx), step_y = _mm_set1_epi32(4*dy), step_z = _mm_set1_epi32(4*dz);
+	__m128i one_x = _mm_cvtsi32_si128(dx), one_y = _mm_cvtsi32_si128(dy), one_z = _mm_cvtsi32_si128(dz);
+	__m128i mask_x = _mm_set1_epi32(grid.mask_x), mask_y = _mm_set1_epi32(grid.mask_y);
+	__m128i shift_y = _mm_cvtsi32_si128(grid.shift_y);
+	__m128i x_begin = _mm_setr_epi32(-lattice.Dx, -lattice.Dx + 1, -lattice.Dx + 2, -lattice.Dx + 3);
+	__m128i four = _mm_set1_epi32(4), one = _mm_cvtsi32_si128(1);
+	__m128i zero = _mm_setzero_si128();
+
+	// z < 256, |x|,|y| < 32768: x*z и y*z через madd_epi16, старшие половины z нулевые
+	__m128i sz = zero, sxz = zero, syz = zero, zeros = zero;
+	__m128i z_max = zero, z_min = _mm_set1_epi32(100000), dz_max = zero;
+	alignas(16) int offsets[4];
+
+	int p0x = lattice.p0x, p0y = lattice.p0y, p0z = lattice.p0z;
+	for(int y = -lattice.Dy; y <= lattice.Dy; y++){
+		__m128i vpx = _mm_add_epi32(_mm_set1_epi32(p0x), lane_x);
+		__m128i vpy = _mm_add_epi32(_mm_set1_epi32(p0y), lane_y);
+		__m128i vpz = _mm_add_epi32(_mm_set1_epi32(p0z), lane_z);
+		__m128i vx = x_begin;
+		__m128i vy = _mm_set1_epi32(y);
+
+		for(int i = 0; i < blocks; i += 4){
+			__m128i gx = _mm_and_si128(_mm_srai_epi32(vpx, groundShl + kmGrid), mask_x);
+			__m128i gy = _mm_and_si128(_mm_srai_epi32(vpy, groundShl + kmGrid), mask_y);
+			_mm_store_si128(reinterpret_cast<__m128i*>(offsets), _mm_or_si128(_mm_sll_epi32(gy, shift_y), gx));
+			__m128i z = _mm_setr_epi32(grid.buffer[offsets[0]], grid.buffer[offsets[1]], grid.buffer[offsets[2]], grid.buffer[offsets[3]]);
+
+			zeros = _mm_sub_epi32(zeros, _mm_cmpeq_epi32(z, zero));
+			z_max = max_epi32(z_max, z);
+			z_min = min_epi32(z_min, z);
+			dz_max = max_epi32(dz_max, _mm_sub_epi32(z, _mm_srai_epi32(vpz, groundShl)));
+			sz = _mm_add_epi32(sz, z);
+			sxz = _mm_add_epi32(sxz, _mm_madd_epi16(z, vx));
+			syz = _mm_add_epi32(syz, _mm_madd_epi16(z, vy));
+
+			vpx = _mm_add_epi32(vpx, step_x);
+			vpy = _mm_add_epi32(vpy, step_y);
+			vpz = _mm_add_epi32(vpz, step_z);
+			vx = _mm_add_epi32(vx, four);
+		}
+
+		// Остаток: в нулевой дорожке, в остальных - нули, которые не трогают итоги
+		for(int i = blocks; i < n; i++){
+			int px = _mm_cvtsi128_si32(vpx), py = _mm_cvtsi128_si32(vpy);
+			int offset = (((py >> (groundShl + kmGrid)) & grid.mask_y) << grid.shift_y) | ((px >> (groundShl + kmGrid)) & grid.mask_x);
+			__m128i z = _mm_cvtsi32_si128(grid.buffer[offset]);
+			__m128i first = _mm_cvtsi32_si128(-1);
+
+			zeros = _mm_sub_epi32(zeros, _mm_and_si128(_mm_cmpeq_epi32(z, zero), first));
+			z_max = max_epi32(z_max, z);
+			z_min = min_epi32(z_min, _mm_or_si128(_mm_and_si128(first, z), _mm_andnot_si128(first, z_min)));
+			dz_max = max_epi32(dz_max, _mm_and_si128(_mm_sub_epi32(z, _mm_srai_epi32(vpz, groundShl)), first));
+			sz = _mm_add_epi32(sz, z);
+			sxz = _mm_add_epi32(sxz, _mm_madd_epi16(z, vx));
+			syz = _mm_add_epi32(syz, _mm_madd_epi16(z, vy));
+
+			vpx = _mm_add_epi32(vpx, one_x);
+			vpy = _mm_add_epi32(vpy, one_y);
+			vpz = _mm_add_epi32(vpz, one_z);
+			vx = _mm_add_epi32(vx, one);
+		}
+
+		p0x += lattice.dpy_x;
+		p0y += lattice.dpy_y;
+		p0z += lattice.dpy_z;
+	}
+
+	stat.Sz = hsum_epi32(sz);
+	stat.Sxz = hsum_epi32(sxz);
+	stat.Syz = hsum_epi32(syz);
+	stat.dz_max = hmax_epi32(dz_max);
+	stat.z_max = hmax_epi32(z_max);
+	stat.z_min = hmin_epi32(z_min);
+	stat.zero_counter = hsum_epi32(zeros);
+}
+#endif
+#ifdef GROUND_NEON
+static void groundLatticeNEON(const GroundGrid& grid, const GroundLattice& lattice, GroundStat& stat)
+{
+	const int n = 2*lattice.Dx + 1;
+	const int blocks = n & ~3;
+	const int dx = lattice.dpx_x, dy = lattice.dpx_y, dz = lattice.dpx_z;
+
+	const int32_t lanes[4] = { 0, 1, 2, 3 };
+	const int32_t first_lane[4] = { -1, 0, 0, 0 };
+	int32x4_t lane = vld1q_s32(lanes);
+	int32x4_t lane_x = vmulq_n_s32(lane, dx), lane_y = vmulq_n_s32(lane, dy), lane_z = vmulq_n_s32(lane, dz);
+	int32x4_t first = vld1q_s32(first_lane);
+	int32x4_t mask_x = vdupq_n_s32(grid.mask_x), mask_y = vdupq_n_s32(grid.mask_y);
+	int32x4_t shift_y = vdupq_n_s32(grid.shift_y);
+	int32x4_t x_begin = vaddq_s32(vdupq_n_s32(-lattice.Dx), lane);
+	int32x4_t zero = vdupq_n_s32(0);
+
+	int32x4_t sz = zero, sxz = zero, syz = zero;
+	uint32x4_t zeros = vdupq_n_u32(0);
+	int32x4_t z_max = zero, z_min = vdupq_n_s32(100000), dz_max = zero;
+	int32_t offsets[4];
+
+	int p0x = lattice.p0x, p0y = lattice.p0y, p0z = lattice.p0z;
+	for(int y = -lattice.Dy; y <= lattice.Dy; y++){
+		int32x4_t vpx = vaddq_s32(vdupq_n_s32(p0x), lane_x);
+		int32x4_t vpy = vaddq_s32(vdupq_n_s32(p0y), lane_y);
+		int32x4_t vpz = vaddq_s32(vdupq_n_s32(p0z), lane_z);
+		int32x4_t vx = x_begin;
+
+		for(int i = 0; i < blocks; i += 4){
+			int32x4_t gx = vandq_s32(vshrq_n_s32(vpx, groundShl + kmGrid), mask_x);
+			int32x4_t gy = vandq_s32(vshrq_n_s32(vpy, groundShl + kmGrid), mask_y);
+			vst1q_s32(offsets, vorrq_s32(vshlq_s32(gy, shift_y), gx));
+			const int32_t heights[4] = { grid.buffer[offsets[0]], grid.buffer[offsets[1]], grid.buffer[offsets[2]], grid.buffer[offsets[3]] };
+			int32x4_t z = vld1q_s32(heights);
+
+			zeros = vsubq_u32(zeros, vceqq_s32(z, zero));
+			z_max = vmaxq_s32(z_max, z);
+			z_min = vminq_s32(z_min, z);
+			dz_max = vmaxq_s32(dz_max, vsubq_s32(z, vshrq_n_s32(vpz, groundShl)));
+			sz = vaddq_s32(sz, z);
+			sxz = vmlaq_s32(sxz, z, vx);
+			syz = vmlaq_n_s32(syz, z, y);
+
+			vpx = vaddq_s32(vpx, vdupq_n_s32(4*dx));
+			vpy = vaddq_s32(vpy, vdupq_n_s32(4*dy));
+			vpz = vaddq_s32(vpz, vdupq_n_s32(4*dz));
+			vx = vaddq_s32(vx, vdupq_n_s32(4));
+		}
+
+		// Остаток: в нулевой дорожке, в остальных - нули, которые не трогают итоги
+		int px = vgetq_lane_s32(vpx, 0), py = vgetq_lane_s32(vpy, 0), pz = vgetq_lane_s32(vpz, 0);
+		for(int x = vgetq_lane_s32(vx, 0); x <= lattice.Dx; x++){
+			int offset = (((py >> (groundShl + kmGrid)) & grid.mask_y) << grid.shift_y) | ((px >> (groundShl + kmGrid)) & grid.mask_x);
+			int32x4_t z = vsetq_lane_s32(grid.buffer[offset], zero, 0);
+
+			zeros = vsubq_u32(zeros, vandq_u32(vceqq_s32(z, zero), vreinterpretq_u32_s32(first)));
+			z_max = vmaxq_s32(z_max, z);
+			z_min = vbslq_s32(vreinterpretq_u32_s32(first), vminq_s32(z_min, z), z_min);
+			dz_max = vmaxq_s32(dz_max, vandq_s32(vsubq_s32(z, vdupq_n_s32(pz >> groundShl)), first));
+			sz = vaddq_s32(sz, z);
+			sxz = vmlaq_n_s32(sxz, z, x);
+			syz = vmlaq_n_s32(syz, z, y);
+
+			px += dx;
+			py += dy;
+			pz += dz;
+		}
+
+		p0x += lattice.dpy_x;
+		p0y += lattice.dpy_y;
+		p0z += lattice.dpy_z;
+	}
+
+	stat.Sz = vaddvq_s32(sz);
+	stat.Sxz = vaddvq_s32(sxz);
+	stat.Syz = vaddvq_s32(syz);
+	stat.dz_max = vmaxvq_s32(dz_max);
+	stat.z_max = vmaxvq_s32(z_max);
+	stat.z_min = vminvq_s32(z_min);
+	stat.zero_counter = vaddvq_u32(zeros);
+}
+#endif
+
+static GroundKernel selectGroundKernel()
+{
+	// ground_scalar - для сверки векторных ядер со скалярным
+	if(!check_command_line("ground_scalar")){
+#if defined(GROUND_SSE2)
+		if(SDL_HasSSE2())
+			return groundLatticeSSE2;
+#elif defined(GROUND_NEON)
+		if(SDL_HasNEON())
+			return groundLatticeNEON;
+#endif
+	}
+	return groundLatticeScalar;
+}
+
+void groundLatticeAnalysis(const GroundLattice& lattice, GroundStat& stat)
+{
+	static const GroundKernel kernel = selectGroundKernel();
+	kernel(groundGrid(), lattice, stat);
+}
+
+void RigidBody::groundLattice(GroundLattice& lattice) const
+{
+	Vect3f dpx, dpy;
+	Vect3f p0 = box_min;
+	p0.y += prm().box_delta_y;
+	matrix().xformPoint(p0);
+	rotation().xform(Vect3f((box_max.x - box_min.x)/(2*Dx), 0, 0), dpx);
+	rotation().xform(Vect3f(0, (box_max.y - box_min.y)/(2*Dy), 0), dpy);
+
+	const int mul = 1 << groundShl;
+	lattice.p0x = xm::round(p0.x * mul);
+	lattice.p0y = xm::round(p0.y * mul);
+	lattice.p0z = xm::round(p0.z * mul);
+	lattice.dpx_x = xm::round(dpx.x * mul);
+	lattice.dpx_y = xm::round(dpx.y * mul);
+	lattice.dpx_z = xm::round(dpx.z * mul);
+	lattice.dpy_x = xm::round(dpy.x * mul);
+	lattice.dpy_y = xm::round(dpy.y * mul);
+	lattice.dpy_z = xm::round(dpy.z * mul);
+	lattice.Dx = Dx;
+	lattice.Dy = Dy;
+}
+
 void RigidBody::initPose(const Se3f& pose, bool modify_z)
 {
 	setPose(pose);
 	if(modify_z)
 	{
-		Vect3f dpx, dpy;
-		Vect3f p0 = box_min;
-		p0.y += prm().box_delta_y;
-  		matrix().xformPoint(p0);
-		rotation().xform(Vect3f((box_max.x - box_min.x)/(2*Dx), 0, 0), dpx);
-		rotation().xform(Vect3f(0, (box_max.y - box_min.y)/(2*Dy), 0), dpy);
-
-		const int shl = 12, mul = 1 << shl;
-		int p0x = xm::round(p0.x * mul), p0y = xm::round(p0.y * mul);//, p0z = xm::round(p0.z * mul);
-		int dpx_x = xm::round(dpx.x * mul), dpx_y = xm::round(dpx.y * mul), dpx_z = xm::round(dpx.z * mul);
-		int dpy_x = xm::round(dpy.x * mul), dpy_y = xm::round(dpy.y * mul),	dpy_z = xm::round(dpy.z * mul);
-		int z_max = 0;
-
-		for(int y = -Dy; y <= Dy; y++)
-		{
-			int px = p0x, py = p0y;//, pz = p0z;
-			for(int x = -Dx; x <= Dx; x++)
-			{
-				int z = vMap.GVBuf[vMap.offsetGBufC(px >> (shl+kmGrid),	py >> (shl+kmGrid))];
-				if(z_max < z)
-					z_max = z;
-
-				px += dpx_x;
-				py += dpx_y;
-				//pz += dpx_z;
-			}
-			p0x += dpy_x;
-			p0y += dpy_y;
-			//p0z += dpy_z;
-		}
+		GroundLattice lattice;
+		groundLattice(lattice);
+		GroundStat stat;
+		groundLatticeAnalysis(lattice, stat);
 
-		float positionZ = z_max;
+		float positionZ = stat.z_max;
 		if(flyingMode()){
 			positionZ += flyingHeight();
 		}
@@ -199,66 +504,16 @@ void RigidBody::ground_analysis(float dt)
 {
 	start_timer_auto(ground_analysis, STATISTICS_GROUP_PHYSICS);
 
-	int Sz = 0, Sxz = 0, Syz = 0, dz_max = 0, z_max = 0, z_min = 100000;
 	float kx = (box_max.x - box_min.x)/(2*Dx);
 	float ky = (box_max.y - box_min.y)/(2*Dy);
-	Vect3f dpx, dpy;
-	Vect3f p0 = box_min;
-	p0.y += prm().box_delta_y;
-  	matrix().xformPoint(p0);
-	rotation().xform(Vect3f(kx, 0, 0), dpx);
-	rotation().xform(Vect3f(0, ky, 0), dpy);
 	int obstacle_x = 0, obstacle_y = 0, obstacle_counter = 0;
-	int chaosCollidingCounter = 0;
-
-	const int shl = 12, mul = 1 << shl;
-	int p0x= xm::round(p0.x * mul),
-		p0y= xm::round(p0.y * mul),
-		p0z= xm::round(p0.z * mul);
-
-	int dpx_x= xm::round(dpx.x * mul),
-		dpx_y= xm::round(dpx.y * mul),
-		dpx_z= xm::round(dpx.z * mul);
-
-	int dpy_x= xm::round(dpy.x * mul),
-		dpy_y= xm::round(dpy.y * mul),
-		dpy_z= xm::round(dpy.z * mul);
-
-	for(int y = -Dy; y <= Dy; y++)
-	{
-		int px=p0x, py=p0y, pz=p0z;
-		for(int x = -Dx; x <= Dx; x++)
-		{
-			int zp = pz >> shl;
-			int z = vMap.GVBuf[vMap.offsetGBufC(px >> (shl+kmGrid),	py >> (shl+kmGrid))];
-			
-			if(z == 0){
-				//obstacle_x += x;
-				//obstacle_y += y;
-				//obstacle_counter++;
-				chaosCollidingCounter++;
-				}
-			if(z_max < z)
-				z_max = z;
-			if(z_min > z)
-				z_min = z;
-
-			int dz = z - zp;
-			if(dz_max < dz)
-				dz_max = dz;
 
-			Sz += z;
-			Sxz += x*z;
-			Syz += y*z;
-
-			px += dpx_x;
-			py += dpx_y;
-			pz += dpx_z;
-		}
-		p0x += dpy_x;
-		p0y += dpy_y;
-		p0z += dpy_z;
-	}
+	GroundLattice lattice;
+	groundLattice(lattice);
+	GroundStat stat;
+	groundLatticeAnalysis(lattice, stat);
+	int Sz = stat.Sz, Sxz = stat.Sxz, Syz = stat.Syz, dz_max = stat.dz_max, z_max = stat.z_max, z_min = stat.z_min;
+	int chaosCollidingCounter = stat.zero_counter;
 
 	Vect3f z_axis;
 	float dZ = -box_min.z + deltaZ_ - position().z;
@@ -37,10 +37,31 @@ private:
 	friend class RigidBody;
 	friend class MultiBodyDispatcher;
 };
-typedef std::list<Contact> ContactList;
+typedef std::vector<Contact> ContactList; // указатели телам раздает MultiBodyDispatcher::link после сбора
 typedef std::vector<Contact*> ContactPtrList;
 
 
+//------------------------------------
+// Опрос сетки вокселей решеткой (2Dx+1)x(2Dy+1) в фиксированной точке (12 бит дроби)
+struct GroundLattice
+{
+	int p0x, p0y, p0z;
+	int dpx_x, dpx_y, dpx_z;
+	int dpy_x, dpy_y, dpy_z;
+	int Dx, Dy;
+};
+
+// Целочисленные итоги, все ядра обязаны давать одинаковый результат
+struct GroundStat
+{
+	int Sz, Sxz, Syz;
+	int dz_max, z_max, z_min;
+	int zero_counter;
+};
+
+// Опрос решетки ядром, выбранным при первом вызове
+void groundLatticeAnalysis(const GroundLattice& lattice, GroundStat& stat);
+
 //------------------------------------
 
 class RigidBody
@@ -278,6 +299,7 @@ private:
 	void applyDiggingForce();
 	bool controlled() const { return !way_points.empty(); }
 	void ground_analysis(float dt);
+	void groundLattice(GroundLattice& lattice) const;
 	void rocket_analysis(float dt);
 	void obstacle_analysis();
 	void add_obstacle_point(const Vect3f& point);
@@ -313,7 +335,24 @@ public:
 	void resolveSmart(); // call before evolve
 
 private:
-	ContactList contacts;
+	ContactList contacts; // пул, емкость сохраняется между квантами
+
+	// resolve(): контакты, связанные через подвижные тела, образуют острова.
+	// В каждом острове - индексированная куча по normal_velocity, сверху - куча островов.
+	// Порядок разрешения тот же, что у перебора всего списка: минимум, при равенстве - первый по списку.
+	std::vector<float> contact_keys;
+	std::vector<int> contact_island; // union-find, затем номер острова
+	std::vector<int> contact_heap; // кучи островов подряд
+	std::vector<int> contact_heap_pos; // позиция от начала кучи острова
+	std::vector<int> island_begin;
+	std::vector<int> island_heap;
+	std::vector<int> island_heap_pos;
+
+	void link();
+	int findIsland(int contact);
+	void buildIslands();
+	float contactKey(int contact);
+	
 	
 	friend RigidBody;
 };
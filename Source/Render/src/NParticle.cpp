@@ -11,10 +11,11 @@
 #include "xmath.h"
 #include "files/files.h"
 #include "DrawBuffer.h"
+#include "../../HT/JobPool.h"
 
 const size_t PARTICLE_BUF_LOCK_LEN = 50;
 
-static RandomGenerator rnd;
+static thread_local RandomGenerator rnd;//эмиттеры разных эффектов считаются в разных потоках
 static std::vector<Vect2f> rotate_angle;
 
 float GlobalParticleRate = 1.0f;
@@ -84,6 +85,7 @@ cEmitterBase::cEmitterBase()
 	TraceCount = 1;
 	PlumeInterval = 0.01f;
 	other = nullptr;
+	prepared_camera = nullptr;
 }
 
 cEmitterBase::~cEmitterBase()
@@ -317,9 +319,20 @@ void cEmitterBase::SetEmitterKey(EmitterKeyBase& k,cEmitter3dObject* models)
 	chPlume		  = k.chPlume;
 	TraceCount    = k.TraceCount;
 	PlumeInterval = k.PlumeInterval; 
+	plume_pool.Init(TraceCount);
 //	PlumeTimeScaling = k.PlumeTimeScaling;
 //	PlumeSizeScaling = k.PlumeSizeScaling;
 }
+
+void cEmitterBase::InitPlume(int& plume,const Vect3f& begin_pos)
+{
+	if(plume<0)
+		plume=plume_pool.Alloc();
+	Vect3f* plume_pos=plume_pool.Get(plume);
+	for(int i=0;i<TraceCount;i++)
+		plume_pos[i]=begin_pos;
+}
+
 inline Vect3f* cEmitterBase::GetNormal(const int& ix)
 {
 	switch(particle_position.type)
@@ -520,14 +533,45 @@ cEmitterInt::~cEmitterInt()
 {
 }
 
+void ParticleQuadBuffer::Submit(DrawBuffer* db)
+{
+    indices_t* ib = nullptr;
+    sVertexXYZDT1 *v = nullptr;
+    for (size_t i=0;i<quads;i++) {
+        db->AutoLockQuad<sVertexXYZDT1>(PARTICLE_BUF_LOCK_LEN, 1, v, ib);
+        memcpy(v, &vertices[i*4], 4*sizeof(sVertexXYZDT1));
+    }
+    db->AutoUnlock();
+    quads=0;
+}
+
+void ParticleQuadBuffer::LockDirect(size_t locked_quads, size_t count, sVertexXYZDT1*& v, indices_t*& ib)
+{
+    direct->AutoLockQuad<sVertexXYZDT1>(locked_quads, count, v, ib);
+}
+
+void cEmitterBase::DrawQuads(cCamera *pCamera, DrawBuffer* db)
+{
+    if (prepared_camera == pCamera) {
+        quad_buffer.Submit(db);
+    } else {
+        quad_buffer.SetDirect(db);
+        PrepareDraw(pCamera);
+        quad_buffer.SetDirect(nullptr);
+        db->AutoUnlock();
+    }
+    prepared_camera = nullptr;
+}
+
 template<class nParticle> FORCEINLINE int ParticlePutToBuf(cEmitterBase* emitter, nParticle& p, Vect3f& npos, float& dt,
-                                                                 DrawBuffer* db, sVertexXYZDT1*& v, indices_t*& ib,
+                                                                 ParticleQuadBuffer* db, sVertexXYZDT1*& v, indices_t*& ib,
                                                                  const uint32_t& color, const Vect3f& PosCamera,
                                                                  const float& size, const cTextureAviScale::RECT& rt,
                                                                  const uint8_t mode, MatXf* iGM = nullptr)
 
 {
-	xassert(!p.plume_pos.empty());
+	xassert(p.plume>=0);
+	Vect3f* plume_pos = emitter->GetPlumePos(p.plume);
 	float dv1 = (rt.right - rt.left)/emitter->GetTraceCount();
 	float v1 = rt.left;
 	Vect3f prev_lt,prev_lb;
@@ -535,7 +579,7 @@ template<class nParticle> FORCEINLINE int ParticlePutToBuf(cEmitterBase* emitter
 	Vect3f vCameraToObject;
 	if(mode&1) vCameraToObject.set(0,0,1);
 	else vCameraToObject = PosCamera - /*GetGlobalMatrix()*/npos;
-	sy.cross(vCameraToObject, npos - p.plume_pos[0]);
+	sy.cross(vCameraToObject, npos - plume_pos[0]);
 	FastNormalize(sy);
 	sy*=size;
 	prev_lt = npos - sy;
@@ -573,7 +617,7 @@ template<class nParticle> FORCEINLINE int ParticlePutToBuf(cEmitterBase* emitter
 		prev_lt.write(v[0].pos); v[0].diffuse=color; v[0].GetTexel().set(v1, rt.top);		//	(0,0);
 		prev_lb.write(v[1].pos); v[1].diffuse=color; v[1].GetTexel().set(v1, rt.bottom);	//	(0,1);
 
-		Vect3f pos = p.plume_pos[i];
+		Vect3f pos = plume_pos[i];
 		pos+= (prev_pos - pos)*(dt/(real_interval+dt));
 		if(mode&2) 
 		{
@@ -614,7 +658,7 @@ template<class nParticle> FORCEINLINE int ParticlePutToBuf(cEmitterBase* emitter
 		else
 		{
 			real_interval = interval;
-			p.plume_pos[i] = pos;
+			plume_pos[i] = pos;
 		}
 		if (p.time_summary<=1)v1+=dv1*(real_interval/interval);
 		prev_lt.write(v[2].pos); v[2].diffuse=color; v[2].GetTexel().set(v1,rt.top);		//  (1,0);
@@ -669,7 +713,21 @@ void cEmitterInt::Draw(cCamera *pCamera)
         rd->FlushPrimitive3D();
     }
 
-    
+    rd->SetNoMaterial(sprite_blend, 0, GetTexture(0));
+    if (relative) {
+        rd->SetWorldMatXf(GetGlobalMatrix());
+    } else {
+        rd->SetWorldMat4f(nullptr);
+    }
+    DrawQuads(pCamera, rd->GetDrawBuffer(sVertexXYZDT1::fmt, PT_TRIANGLES, PARTICLE_BUF_LOCK_LEN * 4 * 10));
+}
+
+void cEmitterInt::PrepareDraw(cCamera *pCamera)
+{
+	if(no_show_obj_editor)
+		return;
+
+    cInterfaceRenderDevice* rd = pCamera->GetRenderDevice();
     float dtime_global=(time-old_time);
 
     MatXf mat=pCamera->GetMatrix();
@@ -680,7 +738,6 @@ void cEmitterInt::Draw(cCamera *pCamera)
         texture = (cTextureAviScale*) GetTexture(0);
     }
     
-    rd->SetNoMaterial(sprite_blend, 0, GetTexture(0));
     Vect3f CameraPos;
     if (relative) {
         if (chPlume) {
@@ -688,16 +745,15 @@ void cEmitterInt::Draw(cCamera *pCamera)
             invGlobMatrix.invert();
             CameraPos = invGlobMatrix*pCamera->GetPos();
         }
-        rd->SetWorldMatXf(GetGlobalMatrix());
     } else {
         if (chPlume) CameraPos = pCamera->GetPos();
-        rd->SetWorldMat4f(nullptr);
     }
 
     indices_t* ib = nullptr;
     sVertexXYZDT1 *v = nullptr;
     size_t size=Particle.size();
-    DrawBuffer* db = rd->GetDrawBuffer(sVertexXYZDT1::fmt, PT_TRIANGLES, PARTICLE_BUF_LOCK_LEN * 4 * 10);
+    ParticleQuadBuffer* db = &quad_buffer;
+    db->Clear();
     for (int i=size-1;i>=0;i--) {
 /*		nParticle& p=Particle[i];
         if(p.key<0)continue;
@@ -764,10 +820,10 @@ void cEmitterInt::Draw(cCamera *pCamera)
         }
         ProcessTime(p,dtime,i,pos);
     }
-    db->AutoUnlock();
     
-	Particle.Compress();
+	Particle.Compress([this](nParticle& p){plume_pool.Free(p.plume);});
 	old_time=time;
+	prepared_camera=pCamera;
 }
 
 void cEmitterInt::ProcessTime(nParticle& p,float dt,int i,Vect3f& cur_pos)
@@ -1000,11 +1056,7 @@ void cEmitterInt::EmitOne(int ix_cur/*nParticle& cur*/,float begin_time)
 	CalcColor(cur);
 	if (chPlume)
 	{	
-		cur.plume_pos.resize(TraceCount);
-		std::vector<Vect3f>::iterator it;
-		Vect3f& bpos = /*GetGlobalMatrix()*/cur.pos0;
-		FOR_EACH(cur.plume_pos,it)
-			*it = bpos;
+		InitPlume(cur.plume,/*GetGlobalMatrix()*/cur.pos0);
 	}
 }
 
@@ -1237,6 +1289,22 @@ cEmitterSpl::~cEmitterSpl()
 }
 
 void cEmitterSpl::Draw(cCamera *pCamera)
+{
+	if(no_show_obj_editor)
+		return;
+
+    cInterfaceRenderDevice* rd = pCamera->GetRenderDevice();
+    
+    rd->SetNoMaterial(sprite_blend, 0, GetTexture(0));
+    rd->SetRenderState( RS_CULLMODE, CULL_NONE );
+    if (relative)
+        rd->SetWorldMatXf(GetGlobalMatrix());
+    else
+        rd->SetWorldMat4f(nullptr);
+    DrawQuads(pCamera, rd->GetDrawBuffer(sVertexXYZDT1::fmt, PT_TRIANGLES, PARTICLE_BUF_LOCK_LEN * 4 * 10));
+}
+
+void cEmitterSpl::PrepareDraw(cCamera *pCamera)
 {
 	if(no_show_obj_editor)
 		return;
@@ -1254,8 +1322,6 @@ void cEmitterSpl::Draw(cCamera *pCamera)
     
     cInterfaceRenderDevice* rd = pCamera->GetRenderDevice();
     
-    rd->SetNoMaterial(sprite_blend, 0, GetTexture(0));
-    rd->SetRenderState( RS_CULLMODE, CULL_NONE );
     Vect3f CameraPos;
     if (relative)
     {
@@ -1265,15 +1331,14 @@ void cEmitterSpl::Draw(cCamera *pCamera)
             invGlobMatrix.invert();
             CameraPos = invGlobMatrix*pCamera->GetPos();
         }
-        rd->SetWorldMatXf(GetGlobalMatrix());
     } else {
         if (chPlume) CameraPos = pCamera->GetPos();
-        rd->SetWorldMat4f(nullptr);
     }
     indices_t* ib = nullptr;
     sVertexXYZDT1 *v = nullptr;
     size_t size=Particle.size();
-    DrawBuffer* db = rd->GetDrawBuffer(sVertexXYZDT1::fmt, PT_TRIANGLES, PARTICLE_BUF_LOCK_LEN * 4 * 10);
+    ParticleQuadBuffer* db = &quad_buffer;
+    db->Clear();
     for(int i=size-1;i>=0;i--)
     {
 /*		nParticle& p=Particle[i];
@@ -1346,11 +1411,10 @@ void cEmitterSpl::Draw(cCamera *pCamera)
         }
         ProcessTime(p,dtime,i);
     }
-
-    db->AutoUnlock();
         
-	Particle.Compress();
+	Particle.Compress([this](nParticle& p){plume_pool.Free(p.plume);});
 	old_time=time;
+	prepared_camera=pCamera;
 }
 
 void cEmitterSpl::SetEmitterKey(EmitterKeySpl& k,cEmitter3dObject* models)
@@ -1603,11 +1667,7 @@ void cEmitterSpl::EmitOne(int ix_cur/*nParticle& cur*/,float begin_time)
 		cur.pos= relative ? cur.pos : GetGlobalMatrix()*cur.pos;
 	if (chPlume)
 	{	
-		cur.plume_pos.resize(TraceCount);
-		std::vector<Vect3f>::iterator it;
-		Vect3f bpos = /*GetGlobalMatrix()*/cur.pos.trans();
-		FOR_EACH(cur.plume_pos,it)
-			*it = bpos;
+		InitPlume(cur.plume,/*GetGlobalMatrix()*/cur.pos.trans());
 	}
 }
 
@@ -1703,6 +1763,7 @@ cEffect::cEffect()
 	auto_delete_after_life=false;
 	particle_rate=1;
 	func_getz=nullptr;
+	prepared_camera=nullptr;
 }
 
 cEffect::~cEffect()
@@ -1771,17 +1832,48 @@ void cEffect::PreDraw(cCamera *pCamera)
 		pCamera->Attach(SCENENODE_OBJECTSORT,this);
 }
 
-void cEffect::Draw(cCamera *pCamera)
+void cEffect::PrepareDraw(cCamera *pCamera)
 {
 #ifdef  NEED_TREANGLE_COUNT
 	count_triangle = 0;
 	square_triangle = 0;
 #endif	
+	std::vector<cEmitterInterface*>::iterator it;
+	FOR_EACH(emitters,it)
+		(*it)->PrepareDraw(pCamera);
+	prepared_camera=pCamera;
+}
+
+void cEffect::Draw(cCamera *pCamera)
+{
+	//Без PrepareDrawParallel эмиттеры считают вершины сами в Draw
+#ifdef  NEED_TREANGLE_COUNT
+	if(prepared_camera!=pCamera)
+	{
+		count_triangle = 0;
+		square_triangle = 0;
+	}
+#endif	
+	prepared_camera=nullptr;
+
 	std::vector<cEmitterInterface*>::iterator it;
 	FOR_EACH(emitters,it)
 		(*it)->Draw(pCamera);
 }
 
+void cEffect::PrepareDrawParallel(std::vector<cEffect*>& effects,cCamera *pCamera)
+{
+	JobPool* job_pool=JobPool::instance();
+	if(!job_pool || effects.size()<2)
+	{
+		std::vector<cEffect*>::iterator it;
+		FOR_EACH(effects,it)
+			(*it)->PrepareDraw(pCamera);
+		return;
+	}
+	job_pool->run(effects.size(), [&effects,pCamera](int i) { effects[i]->PrepareDraw(pCamera); }, "EffectPrepareDraw");
+}
+
 void cEffect::SetCycled(bool cycled)
 {
 	std::vector<cEmitterInterface*>::iterator it;
@@ -1798,22 +1890,59 @@ bool cEffect::IsCycled()const
 	return false;
 }
 
+void cEffect::AnimateEmitter(cEmitterInterface* p,float dt)
+{
+	bool b=time<p->GetStartTime();
+	p->SetPause(b);
+	p->Animate(dt);
+}
+
+void cEffect::AnimateEnd(float dt)
+{
+	time+=dt*1e-3f;
+	if(auto_delete_after_life)
+	{
+		if(!IsLive())
+			Release();
+	}
+}
+
 void cEffect::Animate(float dt)
 {
 	std::vector<cEmitterInterface*>::iterator it;
 	FOR_EACH(emitters,it)
+		AnimateEmitter(*it,dt);
+	AnimateEnd(dt);
+}
+
+void cEffect::AnimateParallel(std::vector<cEffect*>& effects,float dt)
+{
+	std::vector<cEffect*>::iterator it;
+	JobPool* job_pool=JobPool::instance();
+	if(!job_pool || effects.size()<2)
 	{
-		cEmitterInterface* p=*it;
-		bool b=time<p->GetStartTime();
-		p->SetPause(b);
-		p->Animate(dt);
+		FOR_EACH(effects,it)
+			(*it)->Animate(dt);
+		return;
 	}
 
-	time+=dt*1e-3f;
-	if(auto_delete_after_life)
+	//Эмиттеры одного эффекта ссылаются друг на друга (other) - эффект целиком в одном задании
+	job_pool->run(effects.size(), [&effects,dt](int i) {
+		cEffect* effect=effects[i];
+		std::vector<cEmitterInterface*>::iterator ie;
+		FOR_EACH(effect->emitters,ie)
+		if(!(*ie)->AnimateInMainThread())
+			effect->AnimateEmitter(*ie,dt);
+	}, "EffectAnimate");
+
+	FOR_EACH(effects,it)
 	{
-		if(!IsLive())
-			Release();
+		cEffect* effect=*it;
+		std::vector<cEmitterInterface*>::iterator ie;
+		FOR_EACH(effect->emitters,ie)
+		if((*ie)->AnimateInMainThread())
+			effect->AnimateEmitter(*ie,dt);
+		effect->AnimateEnd(dt);
 	}
 }
 
@@ -3409,7 +3538,21 @@ void cEmitterZ::Draw(cCamera *pCamera)
         rd->FlushPrimitive3D();
     }
 
-    
+    rd->SetNoMaterial(sprite_blend, 0, GetTexture(0));
+    if (relative) {
+        rd->SetWorldMatXf(GetGlobalMatrix());
+    } else {
+        rd->SetWorldMat4f(nullptr);
+    }
+    DrawQuads(pCamera, rd->GetDrawBuffer(sVertexXYZDT1::fmt, PT_TRIANGLES, PARTICLE_BUF_LOCK_LEN * 4 * 10));
+}
+
+void cEmitterZ::PrepareDraw(cCamera *pCamera)
+{
+	if(no_show_obj_editor)
+		return;
+
+    cInterfaceRenderDevice* rd = pCamera->GetRenderDevice();
     float dtime_global=(time-old_time);
 
     MatXf mat=pCamera->GetMatrix();
@@ -3429,19 +3572,16 @@ void cEmitterZ::Draw(cCamera *pCamera)
         CameraPos = relative ? iGM*pCamera->GetPos() : pCamera->GetPos();
         mode = (uint8_t)planar + (smooth? 0:2);
     }
-    rd->SetNoMaterial(sprite_blend, 0, GetTexture(0));
     if (relative) {
         GM = GetGlobalMatrix();
         iGM = GM;
         iGM.invert();
-        rd->SetWorldMatXf(GM);
-    } else {
-        rd->SetWorldMat4f(nullptr);
     }
     int size=Particle.size();
     indices_t* ib = nullptr;
     sVertexXYZDT1 *v = nullptr;
-    DrawBuffer* db = rd->GetDrawBuffer(sVertexXYZDT1::fmt, PT_TRIANGLES, PARTICLE_BUF_LOCK_LEN * 4 * 10);
+    ParticleQuadBuffer* db = &quad_buffer;
+    db->Clear();
     for(int i=size-1;i>=0;i--)
     {
         nParticle& p=Particle[i];
@@ -3521,12 +3661,11 @@ void cEmitterZ::Draw(cCamera *pCamera)
         }
         ProcessTime(p,dtime,i,pos);
     }
-
-    db->AutoUnlock();
     
-	Particle.Compress();
+	Particle.Compress([this](nParticle& p){plume_pool.Free(p.plume);});
 
 	old_time=time;
+	prepared_camera=pCamera;
 }
 
 bool cEmitterZ::GetRndPos(Vect3f& pos, Vect3f* norm)
@@ -3597,9 +3736,9 @@ void cEmitterZ::EmitOne(int ix_cur/*nParticle& cur*/,float begin_time)
 */
 		}else
 			z = CalcZ(cur.pos0.x,cur.pos0.y);
-		std::vector<Vect3f>::iterator it;
-		FOR_EACH(cur.plume_pos,it)
-			it->z = z;
+		Vect3f* plume_pos=plume_pool.Get(cur.plume);
+		for(int i=0;i<TraceCount;i++)
+			plume_pos[i].z = z;
 	}
 }
 
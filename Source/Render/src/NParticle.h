@@ -469,6 +469,11 @@ public:
 
 	virtual void SetFunctorGetZ(FunctorGetZ* func){}
 	virtual void AddZ(float z){}
+
+	//Расчет частиц и вершин для Draw без обращений к устройству, можно звать из рабочих потоков
+	virtual void PrepareDraw(cCamera *pCamera){}
+	//Animate создает объекты сцены - только в основном потоке
+	virtual bool AnimateInMainThread() const {return false;}
 protected:
 	virtual void DisableEmitProlonged(){}
 	cEffect* parent;
@@ -482,6 +487,39 @@ protected:
 	bool no_show_obj_editor;
 };
 
+//Вершины частиц, посчитанные в PrepareDraw.
+//Повторяет AutoLockQuad из DrawBuffer, чтобы заполнение шло тем же кодом,
+//Draw потом только копирует готовые квады в DrawBuffer.
+class ParticleQuadBuffer
+{
+	std::vector<sVertexXYZDT1> vertices;
+	size_t quads;
+	class DrawBuffer* direct;//без пула вершины пишутся сразу в DrawBuffer, минуя копию
+	void LockDirect(size_t locked_quads,size_t count,sVertexXYZDT1*& v,indices_t*& ib);
+public:
+	ParticleQuadBuffer():quads(0),direct(nullptr){}
+
+	template<class TVERTEX,class TINDEX>
+	void AutoLockQuad(size_t locked_quads,size_t count,TVERTEX*& v,TINDEX*& ib)
+	{
+		if(direct)
+		{
+			LockDirect(locked_quads,count,v,ib);
+			return;
+		}
+		size_t need=(quads+count)*4;
+		if(need>vertices.size())
+			vertices.resize(need>vertices.size()*2 ? need : vertices.size()*2);
+		v=&vertices[quads*4];
+		quads+=count;
+	}
+	void AutoUnlock(){}
+
+	void Clear(){quads=0;}
+	void SetDirect(DrawBuffer* db){direct=db;}
+	void Submit(DrawBuffer* db);
+};
+
 class cEmitterBase:public cEmitterInterface
 {
 public:
@@ -501,6 +539,7 @@ public:
 
     float GetPlumeInterval() const { return PlumeInterval; }
     int GetTraceCount() const { return TraceCount; }
+    Vect3f* GetPlumePos(int plume) { return plume_pool.Get(plume); }
 
 protected:
 
@@ -540,6 +579,10 @@ protected:
 	bool  chPlume;
 	int   TraceCount;
 	float PlumeInterval;
+	PlumePool plume_pool;
+
+	//Блок хвоста для частицы, все точки в begin_pos
+	void InitPlume(int& plume,const Vect3f& begin_pos);
 
 	enum 
 	{
@@ -564,6 +607,11 @@ protected:
 	virtual bool GetRndPos(Vect3f& pos, Vect3f* norm)=0;
 	Vect3f* GetNormal(const int& ix);
 
+	ParticleQuadBuffer quad_buffer;
+	cCamera* prepared_camera;//для какой камеры посчитан quad_buffer
+	//Отдать посчитанные вершины, а если PrepareDraw для этой камеры не было - посчитать их прямо в db
+	void DrawQuads(cCamera *pCamera,DrawBuffer* db);
+
 	void SetEmitterKey(EmitterKeyBase& k,cEmitter3dObject* models);
 	void DisableEmitProlonged() override {disable_emit_prolonged=true;}
 
@@ -602,7 +650,7 @@ public:
 		sColor4c begin_color;
 
 		Vect3f normal;
-		std::vector<Vect3f> plume_pos;
+		int plume = -1;//блок в plume_pool
 	};
 protected:
 	BackVector<nParticle>	Particle;
@@ -619,6 +667,7 @@ public:
 	~cEmitterInt() override;
 
 	void Draw(cCamera *pCamera) override;
+	void PrepareDraw(cCamera *pCamera) override;
 
 	bool IsLive() override {return !Particle.is_empty() || time<emitter_life_time || cycled;}
 
@@ -648,9 +697,8 @@ public:
 	{
 		xassert((uint32_t)ix < Particle.size());
 		nParticle& p = Particle[ix]; 
-		std::vector<Vect3f>::iterator i;
-		FOR_EACH(p.plume_pos,i)
-			*i = p.pos0;
+		if(p.plume>=0)
+			InitPlume(p.plume,p.pos0);
 	};
 };
 
@@ -667,6 +715,7 @@ public:
 	cEmitterZ();
 	~cEmitterZ() override;
 	void Draw(cCamera *pCamera) override;
+	void PrepareDraw(cCamera *pCamera) override;
 	void ProcessTime(nParticle& p,float dt,int i,Vect3f& cur_pos) override;
 	void SetEmitterKey(EmitterKeyZ& k,cEmitter3dObject* models);
 
@@ -718,7 +767,7 @@ class cEmitterSpl:public cEmitterBase
 		//То-же, но для сплайнов
 		int   hkey;
 		float htime;
-		std::vector<Vect3f> plume_pos;
+		int plume = -1;//блок в plume_pool
 		MatXf pos;
 		float angle0,angle_dir;
 		//color0,size0 - константы
@@ -735,6 +784,7 @@ public:
 	~cEmitterSpl() override;
 
 	void Draw(cCamera *pCamera) override;
+	void PrepareDraw(cCamera *pCamera) override;
 	bool IsLive() override {return !Particle.is_empty() || time<emitter_life_time || cycled;}
 
 	void SetEmitterKey(EmitterKeySpl& k,cEmitter3dObject* models);
@@ -757,6 +807,7 @@ public:
 	cEmitterLight();
 	~cEmitterLight() override;
 	void Animate(float dt) override;
+	bool AnimateInMainThread() const override {return true;}
 
 	bool IsLive() override {return time<emitter_life_time || cycled;}
 	bool IsVisible(cCamera *pCamera) override {return false;}
@@ -778,6 +829,7 @@ class cEffect:public cIUnkObjScale
 	float time;
 	bool auto_delete_after_life;
 	float particle_rate;
+	cCamera* prepared_camera;
 
 	class EffectObserverLink:protected ObserverLink
 	{
@@ -798,6 +850,12 @@ public:
 	void Animate(float dt) override;
 	void PreDraw(cCamera *pCamera) override;
 	void Draw(cCamera *pCamera) override;
+	void PrepareDraw(cCamera *pCamera);
+
+	//Эмиттеры разных эффектов считаются параллельно в JobPool, если он есть.
+	//Эффекты могут удалиться (auto_delete_after_life), как после Animate.
+	static void AnimateParallel(std::vector<cEffect*>& effects,float dt);
+	static void PrepareDrawParallel(std::vector<cEffect*>& effects,cCamera *pCamera);
 
 	bool IsLive();
 	void Clear();
@@ -854,6 +912,9 @@ protected:
 	void Add(cEmitterInterface*);//Предполагается, что эмиттер уже инициализированн
 
 	const MatXf& GetCenter3DModel();
+	void AnimateEmitter(cEmitterInterface* p,float dt);
+	void AnimateEnd(float dt);
+
 	std::vector<Vect3f> begin_position;//Распределение по 3D модели
 	std::vector<Vect3f> normal_position;//Распределение по 3D модели
 
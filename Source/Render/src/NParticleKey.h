@@ -211,7 +211,9 @@ public:
 	int GetIndexFree();
 	void SetFree(int n);
 
-	void Compress();
+	void Compress(){Compress([](type&){});}
+	//release вызывается для каждого выброшенного элемента
+	template<class Release> void Compress(Release release);
 };
 
 
@@ -255,8 +257,8 @@ void BackVector<type>::SetFree(int n)
 	stopped.push_back(n);
 }
 
-template <class type>
-void BackVector<type>::Compress()
+template <class type> template<class Release>
+void BackVector<type>::Compress(Release release)
 {
 	if(this->size()<6)
 		return;
@@ -271,8 +273,54 @@ void BackVector<type>::Compress()
 			if(i!=curi)
 				(*this)[curi]=(*this)[i];
 			curi++;
-		}
+		}else
+			release((*this)[i]);
 	}
 
 	this->resize(curi);
 }
+
+/////////////////////////////
+//Хвосты частиц: блоки по TraceCount точек в одном буфере эмиттера.
+//Блок живет вместе со слотом BackVector и переиспользуется,
+//поэтому рождение частицы не выделяет память.
+class PlumePool
+{
+	std::vector<Vect3f> points;
+	std::vector<int> free_blocks;
+	int block_size;
+public:
+	PlumePool():block_size(1){}
+
+	void Init(int size)
+	{
+		points.clear();
+		free_blocks.clear();
+		block_size=size>1 ? size : 1;
+	}
+
+	int Alloc()
+	{
+		if(!free_blocks.empty())
+		{
+			int block=free_blocks.back();
+			free_blocks.pop_back();
+			return block;
+		}
+		int block=points.size()/block_size;
+		points.resize(points.size()+block_size);
+		return block;
+	}
+
+	void Free(int block)
+	{
+		if(block>=0)
+			free_blocks.push_back(block);
+	}
+
+	Vect3f* Get(int block)
+	{
+		VISASSERT(block>=0 && (block+1)*block_size<=points.size());
+		return &points[block*block_size];
+	}
+};
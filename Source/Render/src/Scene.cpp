@@ -13,6 +13,7 @@
 #include "cPlane.h"
 #include "CChaos.h"
 #include "../client/Silicon.h"
+#include "../../HT/JobPool.h"
 
 FILE *gb_fSceneLog=NULL;
 
@@ -120,6 +121,7 @@ void cScene::Animate()
 	float dTime=(float)(CurrentTime-PreviousTime);
 	if(dTime==0) return;
 	MTEnter enter(lock_draw);
+	bool parallel_effects = JobPool::instance() != nullptr;
 
     //Iterate objects
     grid.DisableChanges(true);
@@ -137,11 +139,19 @@ void cScene::Animate()
                 r->GetLight().clear();
             }
             if (p->GetAttr(ATTRUNKOBJ_IGNORE) == 0) {
-                p->Animate(dTime);
+                cEffect* effect = parallel_effects ? dynamic_cast<cEffect*>(p) : nullptr;
+                if (effect) {
+                    AnimateEffectArray.push_back(effect);
+                } else {
+                    p->Animate(dTime);
+                }
                 //p might not be valid after this point!
             }
         }
 	}
+    //Эффекты после остальных объектов, эмиттеры разных эффектов - в рабочих потоках
+    cEffect::AnimateParallel(AnimateEffectArray, dTime);
+    AnimateEffectArray.clear();
     grid.DisableChanges(false);
     
 	if(TileMap) {
@@ -117,6 +117,7 @@ private:
 	MTGVector			UnkLightArray;				// массив источников света сцены
     MTGVector			grid;
 	QuatTree			tree;
+	std::vector<cEffect*> AnimateEffectArray;		// эффекты, которые Animate считает параллельно
 
 	class cTileMap *TileMap;
 
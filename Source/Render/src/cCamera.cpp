@@ -12,6 +12,7 @@
 #include "Font.h"
 #include "VertexFormat.h"
 #include "SafeCast.h"
+#include "../../HT/JobPool.h"
 
 class CameraShader
 {
@@ -687,11 +688,21 @@ void cCamera::DrawSortObject()
 //	RenderDevice->SetRenderState( RS_CULLMODE, D3DCULL_NONE );
 
 	stable_sort(SortArray.begin(),SortArray.end(),ObjectSortByRadius());
+	std::vector<ObjectSort>::iterator it;
+
+	//Частицы считаются заранее в рабочих потоках, Draw только копирует вершины
+	if(JobPool::instance())
+	{
+		PrepareEffectArray.clear();
+		FOR_EACH( SortArray, it )
+		if(cEffect* effect=dynamic_cast<cEffect*>(it->obj))
+			PrepareEffectArray.push_back(effect);
+		cEffect::PrepareDrawParallel(PrepareEffectArray, this);
+	}
 
     uint32_t fogenable = RenderDevice->GetRenderState(RS_FOGENABLE);
 	RenderDevice->SetRenderState(RS_FOGENABLE, false);
 
-	std::vector<ObjectSort>::iterator it;
 	FOR_EACH( SortArray, it )
 	{
 		it->obj->Draw(this);
@@ -204,6 +204,7 @@ protected:
 
 	std::vector<cIUnkClass*>			DrawArray[MAXSCENENODE];
 	std::vector<ObjectSort>			SortArray;
+	std::vector<class cEffect*>		PrepareEffectArray;			// эффекты из SortArray для параллельной подготовки
 	std::vector<cObjectNodeRoot*>	ShadowTestArray;
 	Vect2f						FocusViewPort;				// фокус графического окна
 	Vect2f						ScaleViewPort;				// коэффициенты неоднородности экрана по осям
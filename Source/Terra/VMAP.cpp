@@ -6,6 +6,9 @@
 
 #include "../Util/SystemUtil.h"
 #include "files/files.h"
+#include "files/mapped_file.h"
+#include "../HT/JobPool.h"
+#include "../Util/Tracing.h"
 
 #pragma warning( disable : 4554 )  
 
@@ -18,6 +21,114 @@ extern int DEFAULT_TERRAIN;
 
 vrtMap vMap;
 
+///////////////////////////////////////////////////////////////////
+// sChangedAreas
+
+static bool isEmptyRect(const sRectS& rect)
+{
+	return rect.dx <= 0 || rect.dy <= 0;
+}
+
+// piece минус cut, остаток - не более 4 полос
+static void subtractRect(const sRectS& piece, const sRectS& cut, sChangedAreas::RectList& out)
+{
+	int ix0 = std::max(piece.x, cut.x);
+	int ix1 = std::min(piece.x1(), cut.x1());
+	int iy0 = std::max(piece.y, cut.y);
+	int iy1 = std::min(piece.y1(), cut.y1());
+	if(ix0 >= ix1 || iy0 >= iy1){
+		out.push_back(piece);
+		return;
+	}
+	if(piece.y < iy0)
+		out.push_back(sRectS(piece.x, piece.y, piece.dx, iy0 - piece.y));
+	if(iy1 < piece.y1())
+		out.push_back(sRectS(piece.x, iy1, piece.dx, piece.y1() - iy1));
+	if(piece.x < ix0)
+		out.push_back(sRectS(piece.x, iy0, ix0 - piece.x, iy1 - iy0));
+	if(ix1 < piece.x1())
+		out.push_back(sRectS(ix1, iy0, piece.x1() - ix1, iy1 - iy0));
+}
+
+// Склеивание без расширения: общая сторона целиком
+static bool joinRect(sRectS& a, const sRectS& b)
+{
+	if(a.x == b.x && a.dx == b.dx){
+		if(a.y1() == b.y){
+			a.dy += b.dy;
+			return true;
+		}
+		if(b.y1() == a.y){
+			a.y = b.y;
+			a.dy += b.dy;
+			return true;
+		}
+	}
+	if(a.y == b.y && a.dy == b.dy){
+		if(a.x1() == b.x){
+			a.dx += b.dx;
+			return true;
+		}
+		if(b.x1() == a.x){
+			a.x = b.x;
+			a.dx += b.dx;
+			return true;
+		}
+	}
+	return false;
+}
+
+const sChangedAreas::RectList& sChangedAreas::coalesce()
+{
+	merged_.clear();
+	raw_area_ = merged_area_ = 0;
+
+	RectList::const_iterator ri;
+	FOR_EACH(raw_, ri){
+		// Вырожденные (и завернутые через край карты) отдаем как есть
+		if(isEmptyRect(*ri)){
+			merged_.push_back(*ri);
+			continue;
+		}
+		raw_area_ += ri->dx*ri->dy;
+
+		pieces_.clear();
+		pieces_.push_back(*ri);
+		for(int i = 0; i < merged_.size() && !pieces_.empty(); i++){
+			if(isEmptyRect(merged_[i]))
+				continue;
+			pieces_next_.clear();
+			RectList::const_iterator pi;
+			FOR_EACH(pieces_, pi)
+				subtractRect(*pi, merged_[i], pieces_next_);
+			pieces_.swap(pieces_next_);
+		}
+		merged_.insert(merged_.end(), pieces_.begin(), pieces_.end());
+	}
+
+	bool joined = true;
+	while(joined){
+		joined = false;
+		for(int i = 0; i < merged_.size(); i++){
+			if(isEmptyRect(merged_[i]))
+				continue;
+			for(int j = i + 1; j < merged_.size(); j++)
+				if(!isEmptyRect(merged_[j]) && joinRect(merged_[i], merged_[j])){
+					merged_.erase(merged_.begin() + j);
+					joined = true;
+					j = i;
+				}
+		}
+	}
+
+	RectList::const_iterator mi;
+	FOR_EACH(merged_, mi)
+		if(!isEmptyRect(*mi))
+			merged_area_ += mi->dx*mi->dy;
+
+	return merged_;
+}
+
 const char* vrtMap::worldDataFileLinear = "output.vmp";
 const char* vrtMap::worldIniFile        = "world.ini";
 //char* vrtMap::worldParamZPIniFile = "paramzp.ini";
@@ -37,6 +148,29 @@ const char* vrtMap::worldDataFileSection= "WorldData";
 
 const char* vrtMap::worldRGBCache  = "cache.tga";
 
+//S2T2 - несжатый мир для отображения в память: за заголовком слои VxG, VxD, Atr, Sur (байт на точку)
+//и SupBuf (uint32_t на точку, из cache.tga), каждый с границы страницы.
+//Буферы указывают прямо в отображение, читаются только затронутые страницы, изменения остаются в памяти.
+static const char* VMP_MAPPED_ID = "S2T2";
+static const size_t VMP_MAPPED_ALIGN = 4096;
+enum { VMP_MAPPED_LAYERS = 5 };
+
+static size_t alignVmpMapped(size_t offset)
+{
+	return (offset + VMP_MAPPED_ALIGN - 1) & ~(VMP_MAPPED_ALIGN - 1);
+}
+
+//Смещения слоев от начала файла, возвращает размер файла
+static size_t vmpMappedLayout(size_t layerSize, size_t offsets[VMP_MAPPED_LAYERS])
+{
+	size_t offset = alignVmpMapped(sizeof(vrtMap::sVmpHeader));
+	for(int i = 0; i < VMP_MAPPED_LAYERS; i++){
+		offsets[i] = offset;
+		offset = alignVmpMapped(offset + layerSize*(i == VMP_MAPPED_LAYERS - 1 ? sizeof(uint32_t) : 1));
+	}
+	return offset;
+}
+
 
 unsigned char vrtMap::GetGeoType(int offset, int h) 
 {
@@ -123,6 +257,20 @@ void vrtMap::compressWorlds(int mode) {
             if (tmp.uncompress(fmap) != 0) {
                 ErrH.Abort("Error decompressing world");
             }
+        } else if (VmpHeader.cmpID(VMP_MAPPED_ID)) {
+            if (mode == 2) {
+                continue;
+            }
+            //Собираем слои подряд как в S2T0, SupBuf отбрасывается - он есть в cache.tga
+            size_t layer = static_cast<size_t>(VmpHeader.XS) * VmpHeader.YS;
+            size_t offsets[VMP_MAPPED_LAYERS];
+            vmpMappedLayout(layer, offsets);
+            fmap.realloc(layer * 4);
+            for (int i = 0; i < 4; i++) {
+                fstream.seek(offsets[i], XS_BEG);
+                fstream.read(fmap.buf + layer * i, layer);
+            }
+            fmap.set(layer * 4, XB_BEG);
         }
         fstream.close();
         
@@ -138,6 +286,36 @@ void vrtMap::compressWorlds(int mode) {
                 ErrH.Abort("Error compressing world");
             }
             fmap = std::move(tmp);
+        } else if (mode == 2) {
+            int sizeX = getWorld_H_SIZE(id);
+            int sizeY = getWorld_V_SIZE(id);
+            size_t layer = static_cast<size_t>(sizeX) * sizeY;
+            if (fmap.tell() < layer * 4) {
+                fprintf(stderr, "VMP size doesn't match world.ini, skipping\n");
+                continue;
+            }
+            TGAHEAD tgahead;
+            if (!tgahead.loadHeader(GetTargetName(id, worldRGBCache).c_str())
+             || tgahead.PixelDepth != 24 || tgahead.ImageType != 2
+             || tgahead.Width != sizeX || tgahead.Height != sizeY) {
+                fprintf(stderr, "%s is missing or not 24bit uncompressed, skipping\n", worldRGBCache);
+                continue;
+            }
+            VmpHeader.setID(VMP_MAPPED_ID);
+            VmpHeader.XS = sizeX;
+            VmpHeader.YS = sizeY;
+
+            //Запись идет заголовком и затем буфером, поэтому смещения в буфере без заголовка
+            size_t offsets[VMP_MAPPED_LAYERS];
+            size_t size = vmpMappedLayout(layer, offsets) - sizeof(VmpHeader);
+            XBuffer tmp(size, false);
+            memset(tmp.buf, 0, size);
+            for (int i = 0; i < 4; i++) {
+                memcpy(tmp.buf + offsets[i] - sizeof(VmpHeader), fmap.buf + layer * i, layer);
+            }
+            tgahead.load2RGBL(sizeX, sizeY, reinterpret_cast<uint32_t*>(tmp.buf + offsets[4] - sizeof(VmpHeader)));
+            tmp.set(size, XB_BEG);
+            fmap = std::move(tmp);
         } else {
             ErrH.Abort("Unsupported compression mode");
         }
@@ -197,6 +375,7 @@ vrtMap::vrtMap() {
 	VxGBuf=0; VxDBuf=0; SurBuf=0; AtrBuf=0; RnrBuf=0;
 	GVBuf=0; GABuf=0;
 	SupBuf=0;
+	mappedWorld=0;
 	hZeroPlast=30; //Начальная высота зеропласта
 //	GKABuf=0;
 
@@ -269,13 +448,16 @@ void vrtMap::allocMem4Buf(void)
 	//AtBuf  = new unsigned char [YS_Buf*XS_Buf];//(unsigned char(*)[YS_Buf][XS_Buf])(Buf+offsetAt);
 	//ClTrBuf= new unsigned char [YS_Buf*XS_Buf];//(unsigned char(*)[YS_Buf][XS_Buf])(Buf+offsetClTr);
 
-	VxGBuf = new unsigned char [YS_Buf*XS_Buf];
+	//При отображенном мире слои уже указывают в файл (mapWorldData)
+	if(!mappedWorld){
+		VxGBuf = new unsigned char [YS_Buf*XS_Buf];
+		VxDBuf = new unsigned char [YS_Buf*XS_Buf];
+		SurBuf = new unsigned char [YS_Buf*XS_Buf];
+		AtrBuf = new unsigned char [YS_Buf*XS_Buf];
+		SupBuf = new uint32_t[YS_Buf*XS_Buf];
+	}
 	WVxBuf = VxGBuf; //Текущие редактируемые воксели - гео-слой
-	VxDBuf = new unsigned char [YS_Buf*XS_Buf];
-	SurBuf = new unsigned char [YS_Buf*XS_Buf];
-	AtrBuf = new unsigned char [YS_Buf*XS_Buf];
 	RnrBuf = new unsigned char [YS_Buf*XS_Buf];
-	SupBuf = new uint32_t[YS_Buf*XS_Buf];
 
 #ifdef _SURMAP_
 	SpecSurBuf = new unsigned char [YS_Buf*XS_Buf];
@@ -287,6 +469,49 @@ void vrtMap::allocMem4Buf(void)
 	//GKABuf  = new unsigned char [(YS_Buf>>kmGridK)*(XS_Buf>>kmGridK)];
 
 }
+bool vrtMap::mapWorldData(void)
+{
+	mapped_file* mapping = new mapped_file();
+	if(!mapping->open(GetTargetName(worldDataFileLinear)) || mapping->size() < sizeof(sVmpHeader)
+	 || !reinterpret_cast<sVmpHeader*>(mapping->data())->cmpID(VMP_MAPPED_ID)){
+		delete mapping;
+		return false;
+	}
+	const sVmpHeader* header = reinterpret_cast<const sVmpHeader*>(mapping->data());
+	size_t offsets[VMP_MAPPED_LAYERS];
+	if(header->XS != XS_Buf || header->YS != YS_Buf || mapping->size() < vmpMappedLayout(XS_Buf*YS_Buf, offsets)){
+		delete mapping;
+		ErrH.Abort("VMP size doesn't match world");
+	}
+	mappedWorld = mapping;
+	VxGBuf = mapping->data() + offsets[0];
+	VxDBuf = mapping->data() + offsets[1];
+	AtrBuf = mapping->data() + offsets[2];
+	SurBuf = mapping->data() + offsets[3];
+	SupBuf = reinterpret_cast<uint32_t*>(mapping->data() + offsets[4]);
+	return true;
+}
+
+//Переносит отображенные слои в обычную память, нужно перед записью поверх файла мира
+void vrtMap::unmapWorldData(void)
+{
+	if(!mappedWorld) return;
+	size_t size = XS_Buf*YS_Buf;
+	unsigned char** layers[] = { &VxGBuf, &VxDBuf, &AtrBuf, &SurBuf };
+	for(unsigned char** layer : layers){
+		unsigned char* buf = new unsigned char [size];
+		memcpy(buf, *layer, size);
+		if(WVxBuf == *layer) WVxBuf = buf;
+		if(LvdTex == *layer) LvdTex = buf;
+		*layer = buf;
+	}
+	uint32_t* sup = new uint32_t[size];
+	memcpy(sup, SupBuf, size*sizeof(uint32_t));
+	SupBuf = sup;
+	delete mappedWorld;
+	mappedWorld=0;
+}
+
 void vrtMap::releaseMem4Buf(void)
 {
 //	delete [] GKABuf;
@@ -297,12 +522,17 @@ void vrtMap::releaseMem4Buf(void)
 #ifdef _SURMAP_
 	delete [] SpecSurBuf;
 #endif
-	delete [] SupBuf;
 	delete [] RnrBuf;
-	delete [] AtrBuf;
-	delete [] SurBuf;
-	delete [] VxDBuf;
-	delete [] VxGBuf;
+	if(mappedWorld){
+		delete mappedWorld;
+		mappedWorld=0;
+	} else {
+		delete [] SupBuf;
+		delete [] AtrBuf;
+		delete [] SurBuf;
+		delete [] VxDBuf;
+		delete [] VxGBuf;
+	}
 	VxGBuf=0;
 	//free(Buf);
 	//delete [] ClTrBuf;
@@ -475,7 +705,7 @@ void vrtMap::selectUsedWorld(char* _patch2World)
 	LoadVPR();
 	RenderPrepare1();
 
-	changedAreas.erase(changedAreas.begin(), changedAreas.end());
+	changedAreas.clear();
 	renderAreas.clear();
 }
 
@@ -500,6 +730,7 @@ void vrtMap::prepare(const char* name)
     maxWorld = wTable.size();
     if(maxWorld < 1) ErrH.Abort("Empty world list");
 
+    //compress_worlds=0 - S2T0 без сжатия, 1 - S2T1 сжатый, 2 - S2T2 для отображения в память
     int compress_mode = -1;
     check_command_line_parameter("compress_worlds", compress_mode);
     if (0 <= compress_mode) { 
@@ -650,7 +881,7 @@ void vrtMap::newLoad(const char* dirName)
 	LoadVPR();
 	RenderPrepare1();
 
-	changedAreas.erase(changedAreas.begin(), changedAreas.end());
+	changedAreas.clear();
 	renderAreas.clear();
 }
 
@@ -676,27 +907,56 @@ void vrtMap::delAllZL()
 	}
 }
 
+int vrtMap::rowBandCount(int rows)
+{
+	JobPool* job_pool = JobPool::instance();
+	if(!job_pool) return 1;
+	//С запасом на неравномерность полос
+	return std::max(1, std::min(rows, (job_pool->workers() + 1)*4));
+}
+
+void vrtMap::forEachRowBand(int rows, const RowBandFunction& function, const char* name)
+{
+	int bands = rowBandCount(rows);
+	if(bands == 1){
+		function(0, 0, rows);
+		return;
+	}
+	JobPool::instance()->run(bands, [&](int band){
+		function(band, rows*band/bands, rows*(band + 1)/bands);
+	}, name);
+}
+
 void vrtMap::checkAndRecover()
+{
+	trace_scope(checkAndRecover);
+	forEachRowBand(V_SIZE, [this](int, int begin, int end){ checkAndRecoverRows(begin, end); }, "checkAndRecover");
+}
+
+void vrtMap::checkAndRecoverRows(int begin, int end)
 {
 	unsigned char* ch = changedT;
 	int x,y;
-	for(y=0; y<V_SIZE; y++){
+	for(y=begin; y<end; y++){
 		for(x=0; x<H_SIZE; x++){
 #ifdef _PERIMETER_
 			int off=offsetBuf(x,y);
-			AtrBuf[off]&=0xDF; //Очистка тени
+			unsigned char atr=AtrBuf[off];
+			atr&=0xDF; //Очистка тени
 			//if( (VxGBuf[off]!=hZeroPlast) && (VxDBuf[off]!=hZeroPlast) ){
 			if(SGetAlt(off)!=hZeroPlast<<VX_FRACTION ){
-				AtrBuf[off]&=~(At_NOTPURESURFACE);
+				atr&=~(At_NOTPURESURFACE);
 				ch[y]=1;
 			}
-			if((AtrBuf[off]&At_ZPMASK)==At_ZEROPLAST ){
-				AtrBuf[off]=(AtrBuf[off]&(~At_NOTPURESURFACE))|At_LEVELED;
+			if((atr&At_ZPMASK)==At_ZEROPLAST ){
+				atr=(atr&(~At_NOTPURESURFACE))|At_LEVELED;
 				ch[y]=1;
 			}
+			//Без лишней записи - у отображенного мира неизмененные страницы остаются общими с файлом
+			if(atr!=AtrBuf[off]) AtrBuf[off]=atr;
 
 #else //Surmap
-			AtrBuf[offsetBuf(x,y)]&=0xDF; //Очистка тени
+			if(AtrBuf[offsetBuf(x,y)]&0x20) AtrBuf[offsetBuf(x,y)]&=0xDF; //Очистка тени
 //			AtrBuf[offsetBuf(x,y)]&=~(At_NOTPURESURFACE); //Очистка зеропласта
 //			if( SGetAlt(offsetBuf(x,y))==85<<VX_FRACTION ){
 //				AtrBuf[offsetBuf(x,y)] = (AtrBuf[offsetBuf(x,y)]&(~At_NOTPURESURFACE)) | At_LEVELED;
@@ -870,42 +1130,66 @@ void vrtMap::updateGridChangedAreas2(void)
 
 void vrtMap::fullLoad(bool flag_fastLoad)
 {
+	trace_scope(fullLoad);
 	sVmpHeader VmpHeader;
 
 	delLeveledTexture();//Необходимо вызывать до удаления VxDBuf !
 	if(VxGBuf!=0) releaseMem4Buf();
+	//S2T2 не читается, а отображается - слои и SupBuf сразу в файле
+	bool mapped = mapWorldData();
 	allocMem4Buf();
 
-    //Read file
-    XBuffer fmap(0, true);
-    XStream fstream;
-	if (!fstream.open(GetTargetName(worldDataFileLinear), XS_IN)) {
-        ErrH.Abort("VMP file not found");
-    }
-    fstream.seek(0,XS_BEG);
-    fstream.read(&VmpHeader,sizeof(VmpHeader));
-    int64_t flen = fstream.size() - fstream.tell();
-    
-    //Read content according to header ID
-	if (VmpHeader.cmpID("S2T0")) {
-        fmap.realloc(flen);
-        fstream.read(fmap.buf, flen);
-    } else if (VmpHeader.cmpID("S2T1")) {
-        XBuffer tmp(flen, false);
-        fstream.read(tmp.buf, flen);
-        if (tmp.uncompress(fmap) != 0) {
-            ErrH.Abort("Error decompressing VMP");
+    bool loaded = mapped;
+    bool supLoaded = mapped;
+    if (!mapped) {
+        //Read file
+        XBuffer fmap(0, true);
+        XStream fstream;
+        if (!fstream.open(GetTargetName(worldDataFileLinear), XS_IN)) {
+            ErrH.Abort("VMP file not found");
+        }
+        fstream.seek(0,XS_BEG);
+        fstream.read(&VmpHeader,sizeof(VmpHeader));
+        int64_t flen = fstream.size() - fstream.tell();
+
+        //Read content according to header ID
+        if (VmpHeader.cmpID("S2T0")) {
+            fmap.realloc(flen);
+            fstream.read(fmap.buf, flen);
+        } else if (VmpHeader.cmpID("S2T1")) {
+            XBuffer tmp(flen, false);
+            fstream.read(tmp.buf, flen);
+            if (tmp.uncompress(fmap) != 0) {
+                ErrH.Abort("Error decompressing VMP");
+            }
+            fmap.set(0, XB_BEG);
+        } else if (VmpHeader.cmpID(VMP_MAPPED_ID)) {
+            //Отобразить S2T2 не удалось - слои и SupBuf читаются с их смещений
+            size_t offsets[VMP_MAPPED_LAYERS];
+            if (VmpHeader.XS != XS_Buf || VmpHeader.YS != YS_Buf
+             || static_cast<size_t>(fstream.size()) < vmpMappedLayout(XS_Buf*YS_Buf, offsets)) {
+                ErrH.Abort("VMP size doesn't match world");
+            }
+            unsigned char* layers[VMP_MAPPED_LAYERS] = { VxGBuf, VxDBuf, AtrBuf, SurBuf, reinterpret_cast<unsigned char*>(SupBuf) };
+            for (int i = 0; i < VMP_MAPPED_LAYERS; i++) {
+                fstream.seek(offsets[i], XS_BEG);
+                fstream.read(layers[i], XS_Buf*YS_Buf*(i == VMP_MAPPED_LAYERS - 1 ? sizeof(uint32_t) : 1));
+            }
+            loaded = true;
+            supLoaded = true;
+        }
+
+        fstream.close();
+        if (0 < fmap.length()) {
+            fmap.read(&VxGBuf[0],XS_Buf*YS_Buf);
+            fmap.read(&VxDBuf[0],XS_Buf*YS_Buf);
+            fmap.read(&AtrBuf[0],XS_Buf*YS_Buf);
+            fmap.read(&SurBuf[0],XS_Buf*YS_Buf);
+            loaded = true;
         }
-        fmap.set(0, XB_BEG);
     }
-    
-    fstream.close();
-    if (0 < fmap.length()) {
-		fmap.read(&VxGBuf[0],XS_Buf*YS_Buf);
-		fmap.read(&VxDBuf[0],XS_Buf*YS_Buf);
-		fmap.read(&AtrBuf[0],XS_Buf*YS_Buf);
-		fmap.read(&SurBuf[0],XS_Buf*YS_Buf);
 
+    if (loaded) {
 		loadGeoDamPal();
 
 		checkAndRecover();
@@ -932,14 +1216,16 @@ void vrtMap::fullLoad(bool flag_fastLoad)
 
 	loadLeveledTexture(); //необходимо вызывать после загрузки VxDBuf и палитры
 
-	TGAHEAD tgahead;
-	tgahead.loadHeader(GetTargetName(worldRGBCache).c_str());
-	if((tgahead.PixelDepth!=24) || (tgahead.ImageType!=2)) {
-		///AfxMessageBox("Не поддерживаемый тип TGA (необходим 24bit не компрессованный)");
-		xassert(0&&"Не поддерживаемый тип TGA (необходим 24bit не компрессованный)");
-		return;
+	if(!supLoaded){
+		TGAHEAD tgahead;
+		tgahead.loadHeader(GetTargetName(worldRGBCache).c_str());
+		if((tgahead.PixelDepth!=24) || (tgahead.ImageType!=2)) {
+			///AfxMessageBox("Не поддерживаемый тип TGA (необходим 24bit не компрессованный)");
+			xassert(0&&"Не поддерживаемый тип TGA (необходим 24bit не компрессованный)");
+			return;
+		}
+		tgahead.load2RGBL(XS_Buf, YS_Buf, SupBuf);
 	}
-	tgahead.load2RGBL(XS_Buf, YS_Buf, SupBuf);
 
 	initGrid();
 
@@ -951,6 +1237,7 @@ void vrtMap::fullLoad(bool flag_fastLoad)
 
 bool vrtMap::loadGameMap(XBuffer& ff, bool flag_FastLoad)
 {
+	trace_scope(loadGameMap);
 	//Чтение номера мира
 	int nW;
 	ff.read(&nW, sizeof(cWorld));
@@ -1490,6 +1777,7 @@ void vrtMap::convertPal2TableTexCol()
 void vrtMap::save3BufOnly(void)
 {
 	sVmpHeader VmpHeader;
+	unmapWorldData(); //файл перезаписывается
     XStream fmap;
 	fmap.open(GetTargetName(worldDataFileLinear), XS_OUT);
 	//const char id[4]={'S','2','T','0'};
@@ -1566,30 +1854,41 @@ void vrtMap::restore3Buf(void)
 	//const char id[4]={'S','2','T','0'};
 	fmap.seek(0,XS_BEG);
 	fmap.read(&VmpHeader,sizeof(VmpHeader));
-	if (VmpHeader.cmpID("S2T0")){ //(*(int*)VmpHeader.id == *(int*)id )
+	//Смещения слоев в файле
+	size_t offsets[VMP_MAPPED_LAYERS];
+	bool known=true;
+	if(VmpHeader.cmpID("S2T0")){
+		for(int k=0; k<VMP_MAPPED_LAYERS; k++)
+			offsets[k]=sizeof(VmpHeader)+XS_Buf*YS_Buf*k;
+	}
+	else if(VmpHeader.cmpID(VMP_MAPPED_ID))
+		vmpMappedLayout(XS_Buf*YS_Buf, offsets);
+	else
+		known=false;
+	if (known){
 		int i;
 		for(i=0;i<YS_Buf;i++){
 			if(changedT[i]){
-				fmap.seek(sizeof(VmpHeader)+i*XS_Buf,XS_BEG);
+				fmap.seek(offsets[0]+i*XS_Buf,XS_BEG);
 				fmap.read(&VxGBuf[i*XS_Buf],XS_Buf);
 			}
 		}
 		for(i=0;i<YS_Buf;i++){
 			if(changedT[i]){
-				fmap.seek(sizeof(VmpHeader)+i*XS_Buf+ XS_Buf*YS_Buf,XS_BEG);
+				fmap.seek(offsets[1]+i*XS_Buf,XS_BEG);
 				fmap.read(&VxDBuf[i*XS_Buf],XS_Buf);
 			}
 		}
 		for(i=0;i<YS_Buf;i++){
 			if(changedT[i]){
-				fmap.seek(sizeof(VmpHeader)+i*XS_Buf+ XS_Buf*YS_Buf*2,XS_BEG);
+				fmap.seek(offsets[2]+i*XS_Buf,XS_BEG);
 				fmap.read(&AtrBuf[i*XS_Buf],XS_Buf);
 			}
 		}
 		for(i=0;i<YS_Buf;i++){
 			if(changedT[i]){
 				if(i>0)changedT[i-1]=1; //Для правильного рендера т.к. при рендере используются 2 строки
-				fmap.seek(sizeof(VmpHeader)+i*XS_Buf+ XS_Buf*YS_Buf*3,XS_BEG);
+				fmap.seek(offsets[3]+i*XS_Buf,XS_BEG);
 				fmap.read(&SurBuf[i*XS_Buf],XS_Buf);
 			}
 		}
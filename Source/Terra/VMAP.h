@@ -7,6 +7,7 @@
 
 #include "list"
 #include "vector"
+#include <functional>
 
 #include "xmath.h"
 
@@ -14,6 +15,8 @@
 
 extern int NOISE_AMPL;
 
+class mapped_file;
+
 //Структура определяющая границу кластера
 struct pointB {
 	short x,y;
@@ -75,6 +78,42 @@ struct sRectS {
 	int16_t y1() const { return y + dy; }
 };
 
+// Области, измененные за квант.
+// Сырые прямоугольники копятся в порядке поступления, coalesce() строит из них
+// непересекающийся список, покрывающий то же объединение [x, x + dx) x [y, y + dy).
+// Порядок результата определяется только сырым списком - детерминирован.
+class sChangedAreas {
+public:
+	typedef std::vector<sRectS> RectList;
+	typedef RectList::const_iterator const_iterator;
+
+	sChangedAreas() : raw_area_(0), merged_area_(0) {}
+
+	void push_back(const sRectS& rect) { raw_.push_back(rect); }
+	void clear() { raw_.clear(); merged_.clear(); raw_area_ = merged_area_ = 0; }
+	bool empty() const { return raw_.empty(); }
+
+	const RectList& raw() const { return raw_; }
+	const RectList& coalesce();
+
+	// Результат последнего coalesce()
+	const_iterator begin() const { return merged_.begin(); }
+	const_iterator end() const { return merged_.end(); }
+
+	int rawCount() const { return raw_.size(); }
+	int mergedCount() const { return merged_.size(); }
+	int rawArea() const { return raw_area_; }
+	int mergedArea() const { return merged_area_; }
+
+private:
+	RectList raw_;
+	RectList merged_;
+	RectList pieces_;
+	RectList pieces_next_;
+	int raw_area_;
+	int merged_area_;
+};
+
 //для работы с цветом
 struct tColor {
 	unsigned char r,g,b;
@@ -200,7 +239,7 @@ struct vrtMap {
 
 	unsigned char* changedT;
 
-	std::list<sRectS> changedAreas;
+	sChangedAreas changedAreas;
 	unsigned char* gridChAreas;
 	unsigned char* gridChAreas2;
 
@@ -275,6 +314,9 @@ struct vrtMap {
 
 	uint32_t* SupBuf;
 
+	//Файл мира S2T2 отображен в память: VxGBuf, VxDBuf, AtrBuf, SurBuf и SupBuf указывают в него
+	mapped_file* mappedWorld;
+
 
 	unsigned char* LvdTex;
 	unsigned int LvdTex_clip_mask_x;
@@ -295,6 +337,7 @@ struct vrtMap {
 	tColor colZeroPlast;
 
 	void initGrid(void);
+	void initGridRows(int begin, int end);
 	void loadGrid(XBuffer& ff);
 	void saveGrid(XBuffer& ff);
 	void recalcArea2Grid(int xl, int yt, int xr, int yb );
@@ -368,6 +411,8 @@ struct vrtMap {
 	//Функции загрузки 
 	void allocMem4Buf(void);
 	void releaseMem4Buf(void);
+	bool mapWorldData(void);
+	void unmapWorldData(void);
 
 	void allocChAreaBuf();
 	void releaseChAreaBuf();
@@ -415,8 +460,15 @@ struct vrtMap {
 	void scaling162D(int XSrcSize,int cx,int cy,int xc,int yc,int xside,int yside);
 
 	void checkAndRecover(void);
+	void checkAndRecoverRows(int begin, int end);
 //	void putTga2Surface(void);
 
+	//Построчные проходы по всей карте делятся на полосы строк [begin, end) и идут на JobPool.
+	//Полоса пишет только в свои строки, поэтому результат не зависит от числа потоков
+	typedef std::function<void(int band, int begin, int end)> RowBandFunction;
+	int rowBandCount(int rows);
+	void forEachRowBand(int rows, const RowBandFunction& function, const char* name);
+
 	void delAllZL(void);
 
 	void analyzeINI(const char* name);
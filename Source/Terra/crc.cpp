@@ -92,54 +92,286 @@ static const unsigned int crc32table[256] = {
                    /* 0xF8 */ 0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
                    /* 0xFC */ 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D,
                                             };
-unsigned int crc32(const unsigned char *address, unsigned int size, unsigned int crc)
+
+/*
+ * All implementations below compute the same IEEE-802.3 CRC register as the
+ * byte loop over crc32table (no pre/post inversion), they only differ in
+ * speed. The fastest one supported by the CPU is chosen on the first call.
+ *
+ * SSE4.2 "crc32" instruction is not used: it implements CRC-32C
+ * (Castagnoli), a different polynomial.
+ */
+static unsigned int crc32_bytes(const unsigned char *address, unsigned int size, unsigned int crc)
 {
-//#if 0
-//  /* FAST, but bigger and only good for word-aligned data */
-//  unsigned int *daddr = (unsigned int *)address;
-//  unsigned int  data = FALSE; /* little-endian by default */
-//
-// /*
-//  * TODO: We should really get the current processor big- or
-//  * little-endian state and set "data" accordingly.
-//  */
-//
-//  /* Perform word loop to save on memory accesses */
-//  if (data)
-//    /* big-endian */
-//    for (; (size > 0); size -= sizeof(unsigned int))
-//    {
-//      data = *daddr++;
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >> 24) & 0xFF)) & 0xFF]);
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >> 16) & 0xFF)) & 0xFF]);
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >>  8) & 0xFF)) & 0xFF]);
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >>  0) & 0xFF)) & 0xFF]);
-//    }
-//  else
-//    for (; (size > 0); size -= sizeof(unsigned int))
-//    {
-//      data = *daddr++;
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >>  0) & 0xFF)) & 0xFF]);
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >>  8) & 0xFF)) & 0xFF]);
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >> 16) & 0xFF)) & 0xFF]);
-//      crc = (((crc >> 8) & 0x00FFFFFF) ^
-//             crc32table[(crc ^ ((data >> 24) & 0xFF)) & 0xFF]);
-//    }
-//#else
 	for (; (size > 0); size--) {
 		/* byte loop */
 		crc = (((crc >> 8) & 0x00FFFFFF) ^ crc32table[(crc ^ *address++) & 0x000000FF]);
 	}
-//#endif
+	return(crc);
+}
 
-  return(crc);
+/*
+ * slicing-by-8: eight bytes per step through eight derived tables,
+ * crc32slice[0] is crc32table itself
+ */
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define CRC32_SLICING
+static uint32_t crc32slice[8][256];
+
+static void crc32_init_slicing()
+{
+	for (int i = 0; i < 256; i++)
+		crc32slice[0][i] = crc32table[i];
+	for (int k = 1; k < 8; k++)
+		for (int i = 0; i < 256; i++)
+			crc32slice[k][i] = (crc32slice[k - 1][i] >> 8) ^ crc32table[crc32slice[k - 1][i] & 0xFF];
+}
+
+static unsigned int crc32_slicing(const unsigned char *address, unsigned int size, unsigned int crc)
+{
+	for (; size >= 8; size -= 8, address += 8) {
+		uint32_t one, two;
+		memcpy(&one, address, 4);
+		memcpy(&two, address + 4, 4);
+		one ^= crc;
+		crc = crc32slice[7][one & 0xFF] ^ crc32slice[6][(one >> 8) & 0xFF] ^
+		      crc32slice[5][(one >> 16) & 0xFF] ^ crc32slice[4][one >> 24] ^
+		      crc32slice[3][two & 0xFF] ^ crc32slice[2][(two >> 8) & 0xFF] ^
+		      crc32slice[1][(two >> 16) & 0xFF] ^ crc32slice[0][two >> 24];
+	}
+	return crc32_bytes(address, size, crc);
+}
+#endif
+
+/*
+ * x86: carry-less multiplication folding, 64 bytes per step
+ * ("Fast CRC Computation for Generic Polynomials Using PCLMULQDQ", Intel)
+ */
+#if defined(CRC32_SLICING) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define CRC32_PCLMUL
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32_TARGET_PCLMUL
+#else
+#include <cpuid.h>
+#define CRC32_TARGET_PCLMUL __attribute__((target("sse4.1,pclmul")))
+#endif
+
+static bool crc32_has_pclmul()
+{
+	unsigned int ecx;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	ecx = info[2];
+#else
+	unsigned int eax, ebx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
+#endif
+	/* PCLMULQDQ and SSE4.1 */
+	return (ecx & (1 << 1)) && (ecx & (1 << 19));
+}
+
+/* size >= 64, size % 16 == 0 */
+CRC32_TARGET_PCLMUL
+static unsigned int crc32_pclmul_blocks(const unsigned char *buf, unsigned int size, unsigned int crc)
+{
+	/* bit-reflected constants for 0xEDB88320 */
+	alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+	alignas(16) static const uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+	alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+	alignas(16) static const uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_load_si128((const __m128i*)k1k2);
+	buf += 64;
+	size -= 64;
+
+	/* parallel fold of 64 byte blocks */
+	while (size >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		y5 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+		y6 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+		y7 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+		y8 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+		buf += 64;
+		size -= 64;
+	}
+
+	/* fold into 128 bits */
+	x0 = _mm_load_si128((const __m128i*)k3k4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	/* single fold of 16 byte blocks */
+	while (size >= 16) {
+		x2 = _mm_loadu_si128((const __m128i*)buf);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		buf += 16;
+		size -= 16;
+	}
+
+	/* fold 128 bits to 64 bits */
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+	x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	/* Barrett reduction to 32 bits */
+	x0 = _mm_load_si128((const __m128i*)poly);
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return _mm_extract_epi32(x1, 1);
+}
+
+static unsigned int crc32_pclmul(const unsigned char *address, unsigned int size, unsigned int crc)
+{
+	if (size >= 64) {
+		unsigned int blocks = size & ~15u;
+		crc = crc32_pclmul_blocks(address, blocks, crc);
+		address += blocks;
+		size -= blocks;
+	}
+	return crc32_slicing(address, size, crc);
+}
+#endif
+
+/*
+ * ARMv8: CRC32 instructions implement the same IEEE polynomial
+ */
+#if defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32_ARMV8
+#include <arm_acle.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#ifdef __clang__
+#define CRC32_TARGET_ARMV8 __attribute__((target("crc")))
+#else
+#define CRC32_TARGET_ARMV8 __attribute__((target("+crc")))
+#endif
+
+static bool crc32_has_armv8()
+{
+#if defined(__APPLE__)
+	return true;
+#elif defined(__linux__)
+	return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+	return false;
+#endif
+}
+
+CRC32_TARGET_ARMV8
+static unsigned int crc32_armv8(const unsigned char *address, unsigned int size, unsigned int crc)
+{
+	for (; size >= 8; size -= 8, address += 8) {
+		uint64_t data;
+		memcpy(&data, address, 8);
+		crc = __crc32d(crc, data);
+	}
+	for (; size > 0; size--)
+		crc = __crc32b(crc, *address++);
+	return crc;
+}
+#endif
+
+static crc32_func crc32_select()
+{
+#ifdef CRC32_SLICING
+	crc32_init_slicing();
+#endif
+#ifdef CRC32_ARMV8
+	if (crc32_has_armv8())
+		return crc32_armv8;
+#endif
+#ifdef CRC32_PCLMUL
+	if (crc32_has_pclmul())
+		return crc32_pclmul;
+#endif
+#ifdef CRC32_SLICING
+	return crc32_slicing;
+#else
+	return crc32_bytes;
+#endif
+}
+
+unsigned int crc32(const unsigned char *address, unsigned int size, unsigned int crc)
+{
+	static const crc32_func impl = crc32_select();
+	return impl(address, size, crc);
+}
+
+const char *crc32_variant(int index, crc32_func *func)
+{
+	/* selection also fills the slicing tables */
+	crc32(NULL, 0, startCRC32);
+
+	struct Variant { const char *name; crc32_func func; };
+	Variant variants[4];
+	int count = 0;
+	variants[count].name = "bytes";
+	variants[count++].func = crc32_bytes;
+#ifdef CRC32_SLICING
+	variants[count].name = "slicing-by-8";
+	variants[count++].func = crc32_slicing;
+#endif
+#ifdef CRC32_PCLMUL
+	if (crc32_has_pclmul()) {
+		variants[count].name = "pclmul";
+		variants[count++].func = crc32_pclmul;
+	}
+#endif
+#ifdef CRC32_ARMV8
+	if (crc32_has_armv8()) {
+		variants[count].name = "armv8";
+		variants[count++].func = crc32_armv8;
+	}
+#endif
+	if (index < 0 || index >= count)
+		return NULL;
+	*func = variants[index].func;
+	return variants[index].name;
 }
 
 /**********************************************************************/
@@ -65,6 +65,24 @@ const unsigned short startCRC16=0x0000;      /* CRC initialised to all 0s */
 extern unsigned int crc32(const unsigned char *address, unsigned int size,
                           unsigned int crc);
 
+/*
+ *  Function: crc32_variant
+ *   Purpose: Gives benchmarks access to the crc32 implementations usable
+ *            on this CPU, all of them give the same result as crc32.
+ *            Index 0 is the byte loop, the last one is used by crc32.
+ *
+ *    Params:
+ *       Input: index       implementation number
+ *      Output: func        implementation
+ *
+ *   Returns:
+ *          OK: implementation name
+ *       Error: NULL, index is past the last implementation
+ */
+typedef unsigned int (*crc32_func)(const unsigned char *address, unsigned int size,
+                                   unsigned int crc);
+extern const char *crc32_variant(int index, crc32_func *func);
+
 /**********************************************************************/
 
 /*
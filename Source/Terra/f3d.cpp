@@ -2,6 +2,7 @@
 #include <fstream>
 
 #include "pnint.h"
+#include "../Util/Tracing.h"
 #ifdef _TX3D_LIBRARY_
 	#include <Texture3D.hpp>
 #endif
@@ -125,19 +126,39 @@ int s_f3d::calcTree(int x, int y, int z)
 
 void s_f3d::recalcWorld(void)
 {
-	int i,j;
-	for(i=0; i<vMap.V_SIZE; i++){
-		for(j=0; j<vMap.H_SIZE; j++){
-			int of=vMap.offsetBuf(j,i);
-			if(vMap.VxDBuf[of]==0) {
-				short v=(vMap.VxGBuf[of]<<VX_FRACTION)|(vMap.AtrBuf[of]&VX_FRACTION_MASK);
+	trace_scope(recalcWorld);
+	//Полосы строк считаются параллельно, у каждой полосы своя копия текстуры
+	int bands=vMap.rowBandCount(vMap.V_SIZE);
+#ifdef _TX3D_LIBRARY_
+	std::vector<tx3d::IndexedTexture3D*> textures(bands);
+	for(int band=0; band<bands; band++)
+		textures[band]=new tx3d::IndexedTexture3D(tx3d::Texture3DFactory::createTexture3D(textureXml), indexLattice);
+#else
+	calc(0,0,0); //ленивая инициализация таблиц шума - до запуска потоков
+#endif
+	vMap.forEachRowBand(vMap.V_SIZE, [&](int band, int begin, int end){
+		int i,j;
+		for(i=begin; i<end; i++){
+			for(j=0; j<vMap.H_SIZE; j++){
+				int of=vMap.offsetBuf(j,i);
+				if(vMap.VxDBuf[of]==0) {
+					short v=(vMap.VxGBuf[of]<<VX_FRACTION)|(vMap.AtrBuf[of]&VX_FRACTION_MASK);
 #ifdef _PERIMETER_
-				if(v) 
+					if(v) 
 #endif
-					vMap.SurBuf[of]=calc(j,i, v);
+#ifdef _TX3D_LIBRARY_
+						vMap.SurBuf[of]=calc(textures[band], j,i, v);
+#else
+						vMap.SurBuf[of]=calc(j,i, v);
+#endif
+				}
 			}
 		}
-	}
+	}, "recalcWorld");
+#ifdef _TX3D_LIBRARY_
+	for(int band=0; band<bands; band++)
+		delete textures[band];
+#endif
 }
 
 #ifdef _SURMAP_
@@ -188,9 +209,11 @@ void s_f3d::loadVariable(void)
 	char szBuffer[1024 * 10];
 	ifsTx.get(szBuffer, 1024 * 10, '\0');
 
-	tx3d::Texture3D* pTx = tx3d::Texture3DFactory::createTexture3D(string(szBuffer));
+	textureXml = szBuffer;
+	tx3d::Texture3D* pTx = tx3d::Texture3DFactory::createTexture3D(textureXml);
 	if (!pTx) {
-		pTx = tx3d::Texture3DFactory::createTexture3D("<texture type='Clear'/>");
+		textureXml = "<texture type='Clear'/>";
+		pTx = tx3d::Texture3DFactory::createTexture3D(textureXml);
 	}
 	indexedTexture->setTexture(pTx);
 
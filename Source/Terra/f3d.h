@@ -36,6 +36,15 @@ struct s_f3d {
 		return (this ->* calcFunc)(x,y,z);
 #endif
 	};
+#ifdef _TX3D_LIBRARY_
+	//calc через отдельную копию текстуры - для параллельного пересчета
+	inline int calc(tx3d::IndexedTexture3D* texture, int x, int y, int z){
+		tx3d::Vector3D point(x, y, (float)z * 0.03125f);
+		return texture->getColorIndex(point);
+	};
+	//Описание текущей текстуры, из него создаются копии
+	string textureXml;
+#endif
 
 	int calcMarble(int x, int y, int z);
 	int calcTree(int x, int y, int z);
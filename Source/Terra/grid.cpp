@@ -1,4 +1,5 @@
 #include "stdafxTr.h"
+#include "../Util/Tracing.h"
 
 
 /**/
@@ -37,10 +38,16 @@ bool PointInPolygon (POINT p,T* pg,int N)
 /////////////////////////////////////////////////////////////////////////////////////////////
 
 void vrtMap::initGrid(void)
+{
+	trace_scope(initGrid);
+	forEachRowBand(V_SIZE>>kmGrid, [this](int, int begin, int end){ initGridRows(begin, end); }, "initGrid");
+}
+
+void vrtMap::initGridRows(int begin, int end)
 {
 	int fullhZeroPlast=hZeroPlast<<VX_FRACTION;
 	int i,j,kx,ky;
-	for(i=0; i<(V_SIZE>>kmGrid); i++){
+	for(i=begin; i<end; i++){
 		for(j=0; j<(H_SIZE>>kmGrid); j++){
 			int of=offsetBuf(j<<kmGrid,i<<kmGrid); //Так как сетка кратна размеру -переход через границу карты исключен
 			//if( (j<<kmGrid)==596 && (i<<kmGrid)==464){ //Для брэкпоинта по координатам
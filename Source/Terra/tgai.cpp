@@ -118,7 +118,7 @@ void TGAHEAD::load2RGBL(int sizeX,int sizeY, uint32_t* RGBLBuf)
 	else { ibeg=sizeX-1; iend=-1; ik=-1;}
 	for(j=jbeg; j!=jend; j+=jk){
 		p = line;
-		tgaFile.read(line,vMap.H_SIZE*3);
+		tgaFile.read(line,sizeX*3);
 		for(i = ibeg; i!=iend; i+=ik){
             uint32_t c= (*p++&0xFF) <<16;
 			c|= (*p++&0xFF)<<8;
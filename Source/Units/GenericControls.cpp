@@ -30,6 +30,8 @@ terUnitBase::terUnitBase(const UnitTemplate& data)
 	setPose(Se3f::ID, false);
 
 	RealCollisionCount = 0;
+	CollisionOrderCount = -1;
+	CollisionOrder = 0;
 	MapUpdatedCount = 0;
 
 	collisionGroup_ = attr()->CollisionGroup;
@@ -135,6 +137,15 @@ void terUnitBase::updateIncludingCluster()
 	includingCluster_ = field_dispatcher->getIncludingCluster(position());
 }
 
+void terUnitBase::setUnitClass(int unit_class)
+{
+	if(unitClass_ == unit_class)
+		return;
+	unitClass_ = unit_class;
+	if(Player)
+		Player->updateUnitIndex(this);
+}
+
 void terUnitBase::ChangeUnitOwner(terPlayer* player)
 {
 	Player->removeUnit(this);
@@ -358,6 +369,7 @@ void terUnitBase::universalLoad(SaveUnitData* data)
 	damageMolecula_ = data->damageMolecula;
 	if(data->unitID)
 		(terUnitID&)*this = terUnitID(Player->registerUnitID(data->unitID), playerID());
+	Player->updateUnitIndex(this);
 }
 
 void terUnitBase::showDebugInfo()
@@ -167,7 +167,7 @@ public:
 	virtual int isSingleSelection(){ return 0; }
 
 	int unitClass() const { return unitClass_; }
-	void setUnitClass(int unit_class){ unitClass_ = unit_class; }
+	void setUnitClass(int unit_class);
 
 	//-------------------------------------
 	virtual bool isConstructed() const { return true; }
@@ -221,6 +221,9 @@ public:
 	//-----------------------------------------------------
 	int GetRealCollisionCount() const { return RealCollisionCount; }
 	void SetRealCollisionCount(int count){ RealCollisionCount = count; }
+	// Номер в последовательном порядке CollisionQuant, INT_MAX - если не назначен в этом кванте
+	int GetCollisionOrder(int count) const { return CollisionOrderCount == count ? CollisionOrder : INT_MAX; }
+	void SetCollisionOrder(int count, int order){ CollisionOrderCount = count; CollisionOrder = order; }
 	
 	//-----------------------------------------
 
@@ -264,6 +267,8 @@ private:
 	Se3f pose_;
 
 	int RealCollisionCount;
+	int CollisionOrderCount;
+	int CollisionOrder;
 	int MapUpdatedCount;
 
 	terInterpolationBase* avatar_;
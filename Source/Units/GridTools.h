@@ -226,8 +226,10 @@ private:
 class terUnitGridDisintegratorOperator
 {
 public:
-	terUnitGridDisintegratorOperator(terUnitBase* source_unit,float radius_min,float radius_max) : sourceUnit_(source_unit)
+	terUnitGridDisintegratorOperator(terUnitBase* source_unit,float radius_min,float radius_max) : sourceUnit_(source_unit), targets_(targetsBuffer())
 	{
+		targets_.clear();
+
 		radius_min_ = radius_min * radius_min;
 		radius_max_ = radius_max * radius_max;
 
@@ -243,12 +245,8 @@ public:
 			if(!lp->isDisintegrating()){
 				float dist = p->position2D().distance2(position_);
 				if(dist >= radius_min_ && dist < radius_max_){
-					terUnitLegionary* lp = safe_cast<terUnitLegionary*>(p);
-					TargetContainer::const_iterator it = find(targets_.begin(),targets_.end(),lp);
-					if(it == targets_.end()){
-						float factor = p->attr()->kill_priority + 1.f/(1.f + dist);
-						targets_.push_back(Target(lp,factor));
-					}
+					float factor = p->attr()->kill_priority + 1.f/(1.f + dist);
+					targets_.push_back(Target(lp,factor));
 				}
 			}
 		}
@@ -283,13 +281,29 @@ public:
         }
     };
 
-	typedef std::list<Target> TargetContainer;
-	const TargetContainer& targets() const { return targets_; }
-    
-	void sortTargets() { targets_.sort(TargetOrderingOp()); }
+	typedef std::vector<Target> TargetContainer;
+
+	// Цели выдаются по убыванию приоритета (как после сортировки TargetOrderingOp),
+	// упорядочивается только выданная часть - обычно энергия кончается раньше
+	void sortTargets() { std::make_heap(targets_.begin(), targets_.end(), HeapOrderingOp()); }
+	terUnitLegionary* nextTarget() {
+		if(targets_.empty())
+			return 0;
+		std::pop_heap(targets_.begin(), targets_.end(), HeapOrderingOp());
+		terUnitLegionary* unit = targets_.back().unit();
+		targets_.pop_back();
+		return unit;
+	}
 
 private:
 
+	struct HeapOrderingOp {
+		bool operator() (const Target& t0,const Target& t1) { return TargetOrderingOp()(t1, t0); }
+	};
+
+	// Свой на каждый поток, Scan передает каждый юнит один раз
+	static TargetContainer& targetsBuffer() { static thread_local TargetContainer targets; return targets; }
+
 	float radius_min_;
 	float radius_max_;
 
@@ -299,7 +313,7 @@ private:
 	terUnitBase* sourceUnit_;
 
 	/// Юниты, попавшие в область действия дизинтегратора.
-	TargetContainer targets_;
+	TargetContainer& targets_;
 };
 
 class terUnitGridInvisibilityGeneratorOperator
@@ -1477,10 +1477,10 @@ void terWeaponDisintegrator::quant()
 
 		op.sortTargets();
 
-		terUnitGridDisintegratorOperator::TargetContainer::const_iterator it;
-		FOR_EACH(op.targets(),it){
-			it->unit()->toggleDisintegrate();
-			if(discharge(dischargeSpeed() * float(it->unit()->damageMolecula().aliveElementCount(DAMAGE_FILTER_BASE))))
+		terUnitLegionary* unit;
+		while((unit = op.nextTarget()) != 0){
+			unit->toggleDisintegrate();
+			if(discharge(dischargeSpeed() * float(unit->damageMolecula().aliveElementCount(DAMAGE_FILTER_BASE))))
 				break;
 		}
 
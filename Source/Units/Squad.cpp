@@ -1746,10 +1746,16 @@ struct TargetOrderingOp {
 
 typedef std::vector<TargetData> TargetDataList;
 
+// Списки целей переиспользуются между поисками - свои на каждый поток.
+// Scan передает каждый юнит один раз, повторы не проверяются.
+static thread_local TargetDataList squadTargetsBuffer[2];
+static thread_local TargetDataList technicianTargetsBuffer;
+
 class SquadSearchTargetsScanOp
 {
 public:
 	SquadSearchTargetsScanOp(const Vect2f& pos, float radius_max, const terUnitSquad& squad)
+	: targets_(squadTargetsBuffer)
 	{
 		position_ = pos;
 
@@ -1769,15 +1775,10 @@ public:
 		if(basicSquadMode_){
 			attr = squad.Player->unitAttribute(UNIT_ATTRIBUTE_OFFICER);
 			attackClass_[1] = attr->AttackClass;
-
-			attr = squad.Player->unitAttribute(UNIT_ATTRIBUTE_TECHNIC);
-			attackClass_[2] = attr->AttackClass;
-
-			targets_[1].reserve(16);
-			targets_[2].reserve(16);
 		}
 
-		targets_[0].reserve(16);
+		targets_[0].clear();
+		targets_[1].clear();
 	}
 
 	const TargetDataList& targets(int idx = 0) const { return targets_[idx]; }
@@ -1806,9 +1807,7 @@ public:
 			else
 				f -= float(unit2->possibleDamage()) / float(unit2->damageMolecula().aliveElementCount());
 
-			TargetDataList::const_iterator it = std::find(targets_[0].begin(),targets_[0].end(),unit2);
-			if(it == targets_[0].end())
-				targets_[0].push_back(TargetData(unit2,f));
+			targets_[0].push_back(TargetData(unit2,f));
 		}
 
 		if(!basicSquadMode_) return;
@@ -1816,17 +1815,7 @@ public:
 		if(myUnit_->isEnemy(unit2) && !unit2->isUnseen() && unit2->unitClass() & attackClass_[1]){
 			float f = sqr(unit2->attr()->kill_priority) + 1.f/(1.f + dist2) + 1.f/(1.f + unit2->freezeFactor());
 
-			TargetDataList::const_iterator it = std::find(targets_[1].begin(),targets_[1].end(),unit2);
-			if(it == targets_[1].end())
-				targets_[1].push_back(TargetData(unit2,f));
-		}
-
-		if(!myUnit_->isEnemy(unit2) && unit2->unitClass() & attackClass_[2] && unit2->repairRequest()){
-			float f = sqr(unit2->attr()->kill_priority) + 1.f/(1.f + dist2) + 1.f/unit2->damageMolecula().phase();
-
-			TargetDataList::const_iterator it = std::find(targets_[2].begin(),targets_[2].end(),unit2);
-			if(it == targets_[2].end())
-				targets_[2].push_back(TargetData(unit2,f));
+			targets_[1].push_back(TargetData(unit2,f));
 		}
 	}
 
@@ -1849,15 +1838,16 @@ private:
 	bool ignoreField_;
 	bool excludeHolograms_;
 
-	int attackClass_[3];
+	int attackClass_[2];
 
-	TargetDataList targets_[3];
+	TargetDataList* targets_;
 };
 
 class SquadTechnicianSearchTargetsScanOp
 {
 public:
 	SquadTechnicianSearchTargetsScanOp(const Vect2f& pos, float radius_max, const terUnitSquad& squad)
+	: targets_(technicianTargetsBuffer)
 	{
 		position_ = pos;
 
@@ -1871,13 +1861,17 @@ public:
 
 		includingCluster_ = squad.includingCluster();
 
-		targets_.reserve(16);
+		targets_.clear();
 	}
 
 	const TargetDataList& targets() const { return targets_; }
     
-	void sortTargets() {
-        std::sort(targets_.begin(), targets_.end(), TargetOrderingOp());
+	// Упорядочить только первые count целей, остальные не используются
+	void sortTargets(int count) {
+		if(count < (int)targets_.size())
+			std::partial_sort(targets_.begin(), targets_.begin() + count, targets_.end(), TargetOrderingOp());
+		else
+			std::sort(targets_.begin(), targets_.end(), TargetOrderingOp());
     }
 
 	void operator()(terUnitBase* unit2)
@@ -1893,9 +1887,7 @@ public:
 		if(!myUnit_->isEnemy(unit2) && unit2->unitClass() & attackClass_ && unit2->repairRequest()){
 			float f = sqr(unit2->attr()->kill_priority) + 1.f/(1.f + dist2) + 1.f/unit2->damageMolecula().phase();
 
-			TargetDataList::const_iterator it = find(targets_.begin(),targets_.end(),unit2);
-			if(it == targets_.end())
-				targets_.push_back(TargetData(unit2,f));
+			targets_.push_back(TargetData(unit2,f));
 		}
 	}
 
@@ -1912,7 +1904,7 @@ private:
 
 	int attackClass_;
 
-	TargetDataList targets_;
+	TargetDataList& targets_;
 };
 
 terUnitBase* terUnitSquad::findBestTarget(const Vect2f& pos, float radius)
@@ -2292,24 +2284,22 @@ void terUnitSquad::techniciansQuant()
 {
 	if(currentMutation() != UNIT_ATTRIBUTE_NONE || technician_targets_scan_timer()) return;
 
-	bool flag = false;
+	int technicians = 0;
 
 	SquadUnitList::iterator ui;
 	FOR_EACH(Units, ui){
-		if((*ui)->attr()->ID == UNIT_ATTRIBUTE_TECHNIC && !(*ui)->hasAttackTarget() && (*ui)->isWeaponReady()){
-			flag = true;
-			break;
-		}
+		if((*ui)->attr()->ID == UNIT_ATTRIBUTE_TECHNIC && !(*ui)->hasAttackTarget() && (*ui)->isWeaponReady())
+			technicians++;
 	}
 
 	technician_targets_scan_timer.start(squad_technician_targets_scan_period);
-	if(!flag) return;
+	if(!technicians) return;
 
 	float fire_radius = offensiveMode() && !patrolMode() ? currentAttribute()->sightRadius() : currentAttribute()->fireRadius();
 	fire_radius += radius();
 	SquadTechnicianSearchTargetsScanOp op(position2D(), fire_radius, *this);
 	universe()->UnitGrid.Scan(position().x, position().y, fire_radius, op);
-	op.sortTargets();
+	op.sortTargets(technicians);
 
 	if(op.targets().empty()) return;
 
@@ -726,7 +726,7 @@ void terExternalRegionShowColumn(Column* column,uint32_t color) {
 			}
 		}
 
-		std::list<Cell>::iterator it,it_next,it_prev;
+		CellLine::iterator it,it_next,it_prev;
 		if(next_cell)
 			it_next=next_cell->begin();
 		if(prev_cell)
@@ -868,7 +868,7 @@ void terRegionColumnMain::quant()
 		FOR_EACH(column,it_line)
 		{
 			CellLine& cell=*it_line;
-			std::list<Cell>::iterator it;
+			CellLine::iterator it;
 			FOR_EACH(cell,it)
 			{
 				Cell& c=*it;
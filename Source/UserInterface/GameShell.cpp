@@ -707,6 +707,7 @@ bool GameShell::universalSave(const char* name, bool userSave, MissionDescriptio
 void GameShell::NetQuant()
 {
 	if(NetClient) {
+		trace_scope(NetQuant);
 		NetClient->P2PIQuant();
 	}
 }
@@ -1708,6 +1709,16 @@ void GameShell::KeyPressed(sKey& Key)
 			MakeShot();
 			break;
 
+		//Трассировка: первое нажатие включает, второе выгружает и выключает
+		case VK_F12 | KBD_CTRL | KBD_SHIFT:
+			if(trace_enabled()){
+				trace_enable(false);
+				trace_dump();
+			}
+			else
+				trace_enable(true);
+			break;
+
 #ifdef PERIMETER_DEBUG
 		case VK_F6 | KBD_SHIFT:
 			terRenderDevice->StartCaptureFrame();
@@ -190,7 +190,7 @@ int multiplayerGameDesyncNotifyQuant(float,float) {
     netlog < " Amount: " <= lastDesyncNotify.desync_amount;
     netlog < "\r\n";
     universe()->writeLogList2Buffer(netlog);
-    XStream f(crash_dir + "netlog.txt", XS_OUT);
+    XStream f(crash_dir + "netlog.bin", XS_OUT);
     f.write(netlog.address(), netlog.tell());
     f.close();
     universe()->clearLogList();
@@ -340,4 +340,54 @@ void check_determinacy_quant(bool start)
 		log_buffer.init();
 		}
 }
+
+//Только логический поток, как и сам net_log_buffer
+struct NetLogSite
+{
+	std::string file;
+	std::string name;
+	std::vector<int> lines;//Одно выражение в файле может логироваться в нескольких местах
+};
+static std::unordered_map<uint32_t, NetLogSite> net_log_sites;
+
+uint32_t net_log_site(const char* name, const char* file, int line)
+{
+	const char* base = file;
+	for(const char* p = file; *p; ++p)
+		if(*p == '/' || *p == '\\')
+			base = p + 1;
+
+	XBuffer key(256, true);
+	key < base < ": " < name;
+	uint32_t id = crc32((const unsigned char*)key.address(), key.tell(), startCRC32);
+
+	NetLogSite& site = net_log_sites[id];
+	if(site.lines.empty()){
+		site.file = base;
+		site.name = name;
+	}
+	xassert(site.file == base && site.name == name && "net_log_site: crc collision");
+	auto i = std::lower_bound(site.lines.begin(), site.lines.end(), line);
+	if(i == site.lines.end() || *i != line)
+		site.lines.insert(i, line);
+	return id;
+}
+
+void net_log_write_sites(XBuffer& buf)
+{
+	buf < static_cast<uint32_t>(net_log_sites.size());
+	for(auto& i : net_log_sites){
+		//"файл:строка,строка: имя"
+		XBuffer text(256, true);
+		text < i.second.file.c_str() < ":";
+		for(size_t l = 0; l < i.second.lines.size(); l++){
+			if(l)
+				text < ",";
+			text <= i.second.lines[l];
+		}
+		text < ": " < i.second.name.c_str();
+		buf < i.first < static_cast<uint16_t>(text.tell());
+		buf.write(text.address(), text.tell());
+	}
+}
 #endif		
@@ -2,6 +2,8 @@
 #ifndef __PHYSICS_UTIL_H__
 #define __PHYSICS_UTIL_H__
 
+#include <type_traits>
+#include "NetLogFormat.h"
 #include "../XPrm/Statistics.h"
 #include "../Render/inc/Umath.h"
 
@@ -152,6 +154,11 @@ void show_watch();
 //	verify_log [append_log] [time_to_exit:seconds]
 //
 //	_FORCE_NET_LOG_ - to force network log under non debug
+//
+//	Сетевой лог (net_log_buffer) бинарный: на каждый log_var пишется
+//	id места вызова и сырые байты значения с тегом типа. Имена мест
+//	хранятся в таблице net_log_site и попадают только в дамп рассинхрона,
+//	текст из дампов восстанавливает утилита netlogdiff.
 /////////////////////////////////////////////////////////////////////////////////
 
 #define _FORCE_NET_LOG_
@@ -168,7 +175,59 @@ extern XBuffer log_buffer;
 extern bool net_log_mode;
 extern XBuffer net_log_buffer;
 void check_determinacy_quant(bool start);
-#define log_var(var) { if(log_mode || net_log_mode) { watch_buffer().set(0); watch_buffer() <= var; watch_buffer() < '\0'; if(log_mode) { log_buffer < #var < ": " < watch_buffer().address() < "\n"; } if(net_log_mode){ net_log_buffer < #var < ": " < watch_buffer().address() < "\n"; } } }
+
+//id = crc32("файл: имя") - не зависит от порядка регистрации и от номеров строк, поэтому совпадает
+//у клиентов, чьи сборки отличаются только сдвигом строк. Строки остаются в таблице имен
+uint32_t net_log_site(const char* name, const char* file, int line);
+//Таблица имен мест вызова для дампа
+void net_log_write_sites(XBuffer& buf);
+
+inline void net_log_string(XBuffer& buf, const char* str, size_t len)
+{
+	if(len > UINT16_MAX)
+		len = UINT16_MAX;
+	buf < static_cast<uint8_t>(NET_LOG_STRING) < static_cast<uint16_t>(len);
+	buf.write(str, len);
+}
+
+//Целые пишутся по значению, а не по типу: size_t и long должны совпадать у 32 и 64 битных клиентов
+template<class T>
+inline void net_log_value(XBuffer& buf, const T& var)
+{
+	if constexpr (std::is_convertible<const T&, const char*>::value){
+		const char* str = var;
+		net_log_string(buf, str, strlen(str));
+	}
+	else if constexpr (std::is_enum<T>::value)
+		net_log_value(buf, static_cast<typename std::underlying_type<T>::type>(var));
+	else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value){
+		if(var >= INT32_MIN && var <= INT32_MAX)
+			buf < static_cast<uint8_t>(NET_LOG_INT32) < static_cast<int32_t>(var);
+		else
+			buf < static_cast<uint8_t>(NET_LOG_INT64) < static_cast<int64_t>(var);
+	}
+	else if constexpr (std::is_integral<T>::value){
+		if(var <= UINT32_MAX)
+			buf < static_cast<uint8_t>(NET_LOG_UINT32) < static_cast<uint32_t>(var);
+		else
+			buf < static_cast<uint8_t>(NET_LOG_UINT64) < static_cast<uint64_t>(var);
+	}
+	else if constexpr (std::is_same<T, float>::value)
+		buf < static_cast<uint8_t>(NET_LOG_FLOAT) < var;
+	else if constexpr (std::is_floating_point<T>::value)
+		buf < static_cast<uint8_t>(NET_LOG_DOUBLE) < static_cast<double>(var);
+	else{
+		static_assert(std::is_trivially_copyable<T>::value && sizeof(T) <= UINT16_MAX, "log_var: no binary form for this type");
+		buf < static_cast<uint8_t>(NET_LOG_RAW) < static_cast<uint16_t>(sizeof(T));
+		buf.write(&var, sizeof(T));
+	}
+}
+inline void net_log_value(XBuffer& buf, const std::string& var) { net_log_string(buf, var.c_str(), var.size()); }
+inline void net_log_value(XBuffer& buf, const Vect3f& var) { buf < static_cast<uint8_t>(NET_LOG_VECT3F) < var.x < var.y < var.z; }
+inline void net_log_value(XBuffer& buf, const QuatF& var) { buf < static_cast<uint8_t>(NET_LOG_QUATF) < var.s() < var.x() < var.y() < var.z(); }
+
+//var вычисляется ровно один раз - в нем бывают вызовы logicRND
+#define log_var(var) { if(log_mode || net_log_mode) { auto&& log_var_value = var; if(log_mode) { watch_buffer().set(0); watch_buffer() <= log_var_value; watch_buffer() < '\0'; log_buffer < #var < ": " < watch_buffer().address() < "\n"; } if(net_log_mode){ static const uint32_t log_var_site = net_log_site(#var, __FILE__, __LINE__); net_log_buffer < log_var_site; net_log_value(net_log_buffer, log_var_value); } } }
 #define log_var_crc(address, size)	log_var(crc32((const unsigned char*)address, size, startCRC32))
 #else
 inline void check_determinacy_quant(bool start){}
@@ -97,36 +97,230 @@ public:
 	void remove(T* obj) { obj->decrInsertion(); std::list<T*>::remove(obj); }
 };
 
+// Шаблон для создания сетки в общем пуле.
+// Элементы всех ячеек лежат подряд в одном векторе, упорядоченном по ячейкам,
+// начало, число и емкость ячеек хранятся отдельными массивами.
+// Переполненная ячейка переезжает в конец пула, дыры убираются компактной перестройкой.
+// Порядок обхода ячейки как у GridVector, с lifo - как у GridSingleList.
+template<class T, bool lifo = false>
+class GridPool;
+
+template<class T, bool lifo = false>
+class GridPoolStorage
+{
+public:
+	typedef GridPool<T, lifo> CellRef;
+
+	// Итератор по индексу: не портится при переезде ячеек и росте пула
+	class iterator
+	{
+	public:
+		iterator() : storage_(0), cell_(0), index_(0) {}
+		iterator(const GridPoolStorage* storage, int cell, int index) : storage_(storage), cell_(cell), index_(index) {}
+		T* operator*() const { return storage_->at(cell_, index_); }
+		iterator& operator++() { ++index_; return *this; }
+		bool operator==(const iterator& i) const { return index_ == i.index_; }
+		bool operator!=(const iterator& i) const { return index_ != i.index_; }
+
+	private:
+		const GridPoolStorage* storage_;
+		int cell_;
+		int index_;
+	};
+
+	GridPoolStorage() : holes_(0) {}
+
+	void set(int cells)
+	{
+		pool_.clear();
+		first_.assign(cells, 0);
+		count_.assign(cells, 0);
+		capacity_.assign(cells, 0);
+		holes_ = 0;
+	}
+
+	void clear() { std::fill(count_.begin(), count_.end(), 0); }
+
+	int size() const
+	{
+		int sz = 0;
+		for(int i = 0; i < (int)count_.size(); i++)
+			sz += count_[i];
+		return sz;
+	}
+
+	CellRef cell(int index) const { return CellRef(const_cast<GridPoolStorage*>(this), index); }
+
+	int count(int cell) const { return count_[cell]; }
+	T* at(int cell, int index) const { return pool_[first_[cell] + (lifo ? count_[cell] - 1 - index : index)]; }
+
+	void insert(int cell, T* obj)
+	{
+		if(count_[cell] == capacity_[cell])
+			grow(cell);
+		pool_[first_[cell] + count_[cell]++] = obj;
+	}
+
+	bool remove(int cell, T* obj)
+	{
+		// Ищем с конца, т.к. более подвижные объекты лежат в конце.
+		T** p = pool_.data() + first_[cell];
+		for(int i = count_[cell] - 1; i >= 0; i--)
+			if(p[i] == obj){
+				std::copy(p + i + 1, p + count_[cell], p + i);
+				--count_[cell];
+				return true;
+			}
+		return false;
+	}
+
+private:
+	enum {
+		cell_capacity_min = 4,
+		compact_holes_min = 1024
+	};
+
+	std::vector<T*> pool_;
+	std::vector<int> first_;
+	std::vector<int> count_;
+	std::vector<int> capacity_;
+	int holes_;
+
+	void grow(int cell)
+	{
+		if(holes_ > compact_holes_min && holes_*2 > (int)pool_.size()){
+			compact();
+			if(count_[cell] < capacity_[cell])
+				return;
+		}
+
+		int capacity = capacity_[cell] ? capacity_[cell]*2 : (int)cell_capacity_min;
+		int first = pool_.size();
+		pool_.resize(first + capacity);
+		std::copy(pool_.begin() + first_[cell], pool_.begin() + first_[cell] + count_[cell], pool_.begin() + first);
+		holes_ += capacity_[cell];
+		first_[cell] = first;
+		capacity_[cell] = capacity;
+	}
+
+	// Перестройка пула по порядку ячеек с небольшим запасом
+	void compact()
+	{
+		std::vector<T*> pool;
+		pool.reserve(pool_.size() - holes_);
+		for(int i = 0; i < (int)first_.size(); i++){
+			int capacity = count_[i] ? count_[i] + std::max(count_[i]/2, 2) : 0;
+			int first = pool.size();
+			pool.insert(pool.end(), pool_.begin() + first_[i], pool_.begin() + first_[i] + count_[i]);
+			pool.resize(first + capacity);
+			first_[i] = first;
+			capacity_[i] = capacity;
+		}
+		pool_.swap(pool);
+		holes_ = 0;
+	}
+};
+
+template<class T, bool lifo>
+class GridPool
+{
+public:
+	typedef GridPoolStorage<T, lifo> Storage;
+	typedef typename Storage::iterator iterator;
+
+	GridPool(Storage* storage, int cell) : storage_(storage), cell_(cell) {}
+
+	void insert(T* obj) {
+		xassert(obj != nullptr);
+		storage_->insert(cell_, obj);
+		obj->incrInsertion();
+	}
+	void remove(T* obj) {
+		if(storage_->remove(cell_, obj))
+			obj->decrInsertion();
+		else
+			xassert(0 && "Grid: remove of absent element");
+	}
+
+	iterator begin() const { return iterator(storage_, cell_, 0); }
+	iterator end() const { return iterator(storage_, cell_, storage_->count(cell_)); }
+	int size() const { return storage_->count(cell_); }
+	bool empty() const { return !size(); }
+
+private:
+	Storage* storage_;
+	int cell_;
+};
+
+// Хранилище ячеек по умолчанию: все ячейки одним массивом
+template<class CellList>
+class GridCellArray
+{
+public:
+	typedef CellList& CellRef;
+	typedef typename CellList::iterator iterator;
+
+	GridCellArray() : cells_(0), size_(0) {}
+	~GridCellArray() { delete[] cells_; }
+
+	void set(int cells)
+	{
+		delete[] cells_;
+		size_ = cells;
+		cells_ = new CellList[size_];
+	}
+
+	void clear()
+	{
+		for(int i = 0; i < size_; i++)
+			cells_[i].clear();
+	}
+
+	int size() const
+	{
+		int sz = 0;
+		for(int i = 0; i < size_; i++)
+			sz += cells_[i].size();
+		return sz;
+	}
+
+	CellRef cell(int index) const { return cells_[index]; }
+
+private:
+	CellList* cells_;
+	int size_;
+};
+
+template<class CellList>
+struct GridStorage { typedef GridCellArray<CellList> Type; };
+
+template<class T, bool lifo>
+struct GridStorage<GridPool<T, lifo> > { typedef GridPoolStorage<T, lifo> Type; };
+
 
 //	Сетка
 template <class T, int cell_size_len, class CellList >	
 class Grid2D : GridPassDispatcher
 {
+	typedef typename GridStorage<CellList>::Type Storage;
+	typedef typename Storage::CellRef CellRef;
+	typedef typename Storage::iterator CellIterator;
+
 public:	
 
 	Grid2D(int map_sx,int map_sy)
-	: cell_table(0)
 	{
 		Set(map_sx,map_sy);
 	}
 
-	~Grid2D()
-	{
-		reset();
-	}
-
 	void Set(int map_sx, int map_sy)
 	{
-		reset();
-
 		size_x = map_sx / cell_size;
 		size_y = map_sy / cell_size;
 		//m_mask_x = size_x - 1;
 		//m_mask_y = size_y - 1;
 	
-		cell_table = new CellList*[size_y];
-		for(int i = 0;i < size_y;i++)
-			cell_table[i] = new CellList[size_x];
+		cell_table.set(size_x*size_y);
 	}
 
 	void Insert(T& obj, int xc, int yc, int side)
@@ -179,19 +373,12 @@ public:
 
 	void Clear()
 	{
-		for(int y = 0;y < size_y;y++)
-			for(int x = 0;x < size_x;x++){
-				cell_table[y][x].clear();
-			}
+		cell_table.clear();
 	}
 
 	int size() const // for Debug purpose mostly
 	{
-		int sz = 0;
-		for(int y = 0;y < size_y;y++)
-			for(int x = 0;x < size_x;x++)
-				sz += cell_table[y][x].size();
-		return sz;
+		return cell_table.size();
 	}
 
 	////////////////////////////////////////////////////////////////////////////////////
@@ -211,14 +398,35 @@ public:
 		prepRectangle(rect);
 		for(int y = rect.y0;y <= rect.y1;y++)
 			for(int x = rect.x0;x <= rect.x1;x++){
-				CellList& root = table(x, y);
-				typename CellList::iterator i;
+				CellRef root = table(x, y);
+				CellIterator i;
 				FOR_EACH(root, i)
 					if(doPass(**i))
 						op(*i);
 			}
 	}
 
+	// Сканирование без счетчика проходов, можно вызывать из нескольких потоков,
+	// пока сетка не меняется. visited - буфер вызывающего для отсева повторов,
+	// порядок вызовов op как у Scan.
+	template <class Op>
+	void ScanConcurrent(int xc, int yc, int side, Op& op, std::vector<T*>& visited) const
+	{
+		visited.clear();
+		GridRectangle rect(xc - side, yc - side, xc + side, yc + side);
+		prepRectangle(rect);
+		for(int y = rect.y0;y <= rect.y1;y++)
+			for(int x = rect.x0;x <= rect.x1;x++){
+				CellRef root = table(x, y);
+				CellIterator i;
+				FOR_EACH(root, i)
+					if(std::find(visited.begin(), visited.end(), *i) == visited.end()){
+						visited.push_back(*i);
+						op(*i);
+					}
+			}
+	}
+
 	template <class Op>
 	int ConditionScan(int xc, int yc, int side, Op& op) const { return ConditionScan(xc - side, yc - side, xc + side, yc + side, op); }
 
@@ -230,8 +438,8 @@ public:
 		prepRectangle(rect);
 		for(int y = rect.y0;y <= rect.y1;y++)
 			for(int x = rect.x0;x <= rect.x1;x++){
-				CellList& root = table(x, y);
-				typename CellList::iterator i;
+				CellRef root = table(x, y);
+				CellIterator i;
 				FOR_EACH(root, i)
 					if(doPass(**i))
 						if(!(op(*i)))
@@ -245,8 +453,8 @@ public:
 	{
 		if(insideMap(x, y))
 		{
-			CellList& root = table(x, y);
-			typename CellList::iterator i;
+			CellRef root = table(x, y);
+			CellIterator i;
 			FOR_EACH(root, i)
 				if(doPass(**i))
 					op(*i);
@@ -258,8 +466,8 @@ public:
 	{
 		if(insideMap(x, y))
 		{
-			CellList& root = table(x, y);
-			typename CellList::iterator i;
+			CellRef root = table(x, y);
+			CellIterator i;
 			FOR_EACH(root, i)
 				if(doPass(**i))
 					if(!(op(*i)))
@@ -750,7 +958,7 @@ private:
 		cell_size = 1 << cell_size_len,
 	};
 
- 	CellList** cell_table;
+ 	Storage cell_table;
 
 	int size_x, size_y;
 //	int m_mask_x, m_mask_y;
@@ -771,7 +979,7 @@ private:
 //	int clamp_y(int y) const { return y; }
 //	int insideMap(int x, int y) const {	return 1; }
 
-	CellList& table(int x, int y) const { xassert(x >= 0 && x < size_x && y >= 0 && y < size_y); return cell_table[mask_y(y)][mask_x(x)]; }
+	CellRef table(int x, int y) const { xassert(x >= 0 && x < size_x && y >= 0 && y < size_y); return cell_table.cell(mask_y(y)*size_x + mask_x(x)); }
 
 	// Подготовка области для сканирования
 	void prepRectangle(GridRectangle& rectangle)  const
@@ -781,15 +989,6 @@ private:
 		rectangle.x1 = clamp_x(rectangle.x1 >> cell_size_len);
 		rectangle.y1 = clamp_y(rectangle.y1 >> cell_size_len);
 	}
-
-	void reset()
-	{
-		if(!cell_table)
-			return;
-		for(int i = 0;i < size_y;i++)
-			delete[] cell_table[i];
-		delete[] cell_table;
-	}
 };
 
 #endif  // __GRID_2D__
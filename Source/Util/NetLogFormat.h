@@ -0,0 +1,32 @@
+#ifndef __NET_LOG_FORMAT_H__
+#define __NET_LOG_FORMAT_H__
+
+#include <cstdint>
+
+/////////////////////////////////////////////////////////////////////////////////
+//		Формат бинарного сетевого лога
+// Общий для log_var (DebugUtil.h) и утилиты netlogdiff, поэтому без зависимостей игры.
+// Дамп: NET_LOG_DUMP_MAGIC, NET_LOG_DUMP_VERSION, таблица мест вызова
+// (uint32 число, затем uint32 id, uint16 длина, текст), логи по квантам
+// (uint32 число, затем int32 квант, uint32 размер, записи).
+// Запись: uint32 id места вызова, uint8 NetLogType, значение.
+/////////////////////////////////////////////////////////////////////////////////
+
+const uint32_t NET_LOG_DUMP_MAGIC = 0x474C4E50; //"PNLG"
+const uint32_t NET_LOG_DUMP_VERSION = 1;
+
+enum NetLogType
+{
+	NET_LOG_INT32,
+	NET_LOG_INT64,
+	NET_LOG_UINT32,
+	NET_LOG_UINT64,
+	NET_LOG_FLOAT,
+	NET_LOG_DOUBLE,
+	NET_LOG_STRING, //uint16 длина + символы
+	NET_LOG_VECT3F,
+	NET_LOG_QUATF,
+	NET_LOG_RAW //uint16 размер + байты
+};
+
+#endif //__NET_LOG_FORMAT_H__
@@ -0,0 +1,210 @@
+#include <cstdio>
+#include <ctime>
+#include <cinttypes>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <memory>
+#include <SDL.h>
+#include "Tracing.h"
+
+std::atomic<bool> trace_enabled_flag(false);
+
+static const uint64_t TRACE_CAPACITY = 1 << 16; //событий на поток, степень двойки
+
+struct TraceEvent
+{
+	std::atomic<const char*> name;
+	std::atomic<uint64_t> begin;
+	std::atomic<uint64_t> end;
+};
+
+struct TraceThreadBuffer
+{
+	std::unique_ptr<TraceEvent[]> events;
+	std::atomic<uint64_t> head; //всего записано, пишет только владелец
+	std::atomic<bool> retired; //поток завершился, буфер можно отдать новому
+	uint64_t thread_id;
+	std::string name;
+
+	TraceThreadBuffer() : events(new TraceEvent[TRACE_CAPACITY]), head(0), retired(false), thread_id(0) {}
+};
+
+//Буферы не удаляются - выгрузка может идти параллельно с завершением потока
+static std::vector<TraceThreadBuffer*> trace_buffers;
+
+static SDL_mutex* trace_lock()
+{
+	static SDL_mutex* lock = SDL_CreateMutex();
+	return lock;
+}
+
+struct TraceThreadHolder
+{
+	TraceThreadBuffer* buffer = nullptr;
+	const char* name = nullptr;
+	uint64_t collected = 0; //head на момент прошлого trace_collect
+
+	~TraceThreadHolder() {
+		if(buffer)
+			buffer->retired.store(true, std::memory_order_release);
+	}
+};
+
+static thread_local TraceThreadHolder trace_thread;
+
+static TraceThreadBuffer* trace_attach_thread()
+{
+	SDL_LockMutex(trace_lock());
+	TraceThreadBuffer* buffer = nullptr;
+	for(TraceThreadBuffer* b : trace_buffers)
+		if(b->retired.load(std::memory_order_acquire)){
+			buffer = b;
+			break;
+		}
+	if(!buffer){
+		buffer = new TraceThreadBuffer;
+		trace_buffers.push_back(buffer);
+	}
+	buffer->head.store(0, std::memory_order_relaxed);
+	buffer->retired.store(false, std::memory_order_relaxed);
+	buffer->thread_id = SDL_ThreadID();
+	buffer->name = trace_thread.name ? trace_thread.name : "thread " + std::to_string(trace_buffers.size());
+	SDL_UnlockMutex(trace_lock());
+	return buffer;
+}
+
+void trace_enable(bool enable)
+{
+	trace_enabled_flag.store(enable, std::memory_order_relaxed);
+}
+
+void trace_thread_name(const char* name)
+{
+	trace_thread.name = name;
+	if(trace_thread.buffer){
+		SDL_LockMutex(trace_lock());
+		trace_thread.buffer->name = name;
+		SDL_UnlockMutex(trace_lock());
+	}
+}
+
+void trace_record(const char* name, uint64_t begin, uint64_t end)
+{
+	TraceThreadBuffer* buffer = trace_thread.buffer;
+	if(!buffer)
+		buffer = trace_thread.buffer = trace_attach_thread();
+
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[head & (TRACE_CAPACITY - 1)];
+	event.name.store(name, std::memory_order_relaxed);
+	event.begin.store(begin, std::memory_order_relaxed);
+	event.end.store(end, std::memory_order_relaxed);
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void trace_collect(TraceTotals& totals)
+{
+	TraceThreadBuffer* buffer = trace_thread.buffer;
+	if(!buffer)
+		return;
+
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	uint64_t first = std::max(trace_thread.collected, head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0);
+	for(uint64_t i = first; i < head; i++){
+		const TraceEvent& event = buffer->events[i & (TRACE_CAPACITY - 1)];
+		TraceTotal& total = totals[event.name.load(std::memory_order_relaxed)];
+		total.time += event.end.load(std::memory_order_relaxed) - event.begin.load(std::memory_order_relaxed);
+		total.count++;
+	}
+	trace_thread.collected = head;
+}
+
+static void trace_write_name(FILE* file, const char* name)
+{
+	for(; *name; ++name){
+		if(*name == '"' || *name == '\\')
+			fputc('\\', file);
+		if(static_cast<unsigned char>(*name) >= ' ')
+			fputc(*name, file);
+	}
+}
+
+bool trace_dump(const char* path)
+{
+	std::string file_path;
+	if(path)
+		file_path = path;
+	else{
+		const char* pref_path = GET_PREF_PATH();
+		if(pref_path){
+			file_path = pref_path;
+			SDL_free((void*) pref_path);
+		}
+		char name[64];
+		time_t now = time(nullptr);
+		strftime(name, sizeof(name), "trace_%Y%m%d_%H%M%S.json", localtime(&now));
+		file_path += name;
+	}
+
+	FILE* file = fopen(file_path.c_str(), "wt");
+	if(!file)
+		return false;
+
+	struct Event
+	{
+		const char* name;
+		uint64_t begin, end;
+	};
+	std::vector<Event> events;
+
+	SDL_LockMutex(trace_lock());
+
+	uint64_t base = UINT64_MAX;
+	std::vector<std::vector<Event>> threads(trace_buffers.size());
+	for(int i = 0; i < trace_buffers.size(); i++){
+		TraceThreadBuffer* buffer = trace_buffers[i];
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t first = head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+		events.clear();
+		for(uint64_t j = first; j < head; j++){
+			const TraceEvent& event = buffer->events[j & (TRACE_CAPACITY - 1)];
+			events.push_back({event.name.load(std::memory_order_relaxed), event.begin.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed)});
+		}
+		//Владелец мог переписать начало кольца, пока мы копировали
+		uint64_t head_after = buffer->head.load(std::memory_order_acquire);
+		uint64_t valid = head_after + 1 > TRACE_CAPACITY ? head_after + 1 - TRACE_CAPACITY : 0;
+		if(valid > first)
+			events.erase(events.begin(), events.begin() + std::min<uint64_t>(valid - first, events.size()));
+		for(const Event& event : events)
+			if(base > event.begin)
+				base = event.begin;
+		threads[i].swap(events);
+	}
+
+	double us = 1e6/static_cast<double>(getPerformanceFrequency());
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first_line = true;
+	for(int i = 0; i < trace_buffers.size(); i++){
+		TraceThreadBuffer* buffer = trace_buffers[i];
+		fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu64 ",\"args\":{\"name\":\"",
+				first_line ? "" : ",\n", buffer->thread_id);
+		trace_write_name(file, buffer->name.c_str());
+		fprintf(file, "\"}}");
+		first_line = false;
+		for(const Event& event : threads[i]){
+			if(!event.name)
+				continue;
+			fprintf(file, ",\n{\"name\":\"");
+			trace_write_name(file, event.name);
+			fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%" PRIu64 ",\"ts\":%.3f,\"dur\":%.3f}",
+					buffer->thread_id, (event.begin - base)*us, (event.end - event.begin)*us);
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	SDL_UnlockMutex(trace_lock());
+
+	fclose(file);
+	return true;
+}
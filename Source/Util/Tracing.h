@@ -0,0 +1,55 @@
+#ifndef __TRACING_H__
+#define __TRACING_H__
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include "../XTool/xutl.h"
+
+/////////////////////////////////////////////////////////////////////////////////
+//		Трассировка
+// Работает и в финальной сборке, включается на лету.
+// Каждый поток пишет завершенные интервалы в свой кольцевой буфер без блокировок,
+// trace_dump() выгружает последние события всех потоков в формате Chrome trace
+// (chrome://tracing, ui.perfetto.dev).
+// Ключ командной строки "trace" - включить с запуска, выгрузка при выходе.
+/////////////////////////////////////////////////////////////////////////////////
+
+extern std::atomic<bool> trace_enabled_flag;
+
+inline bool trace_enabled() { return trace_enabled_flag.load(std::memory_order_relaxed); }
+void trace_enable(bool enable);
+
+//Имя текущего потока в трассе
+void trace_thread_name(const char* name);
+
+//name должен жить до выгрузки - строковые литералы
+void trace_record(const char* name, uint64_t begin, uint64_t end);
+
+//path == nullptr - trace_<время>.json в каталоге настроек
+bool trace_dump(const char* path = nullptr);
+
+struct TraceTotal
+{
+	uint64_t time = 0;
+	int count = 0;
+};
+typedef std::unordered_map<const char*, TraceTotal> TraceTotals;
+
+//Суммирует по именам события текущего потока, записанные после прошлого вызова
+//(не больше емкости кольца) - для замеров без выгрузки
+void trace_collect(TraceTotals& totals);
+
+class TraceScope
+{
+	const char* name_;
+	uint64_t begin_;
+public:
+	explicit TraceScope(const char* name) : name_(trace_enabled() ? name : nullptr), begin_(name_ ? getPerformanceCounter() : 0) {}
+	~TraceScope() { if(name_) trace_record(name_, begin_, getPerformanceCounter()); }
+};
+
+#define trace_scope(title) TraceScope trace_scope_##title(#title);
+#define trace_scope_id(id, name) TraceScope trace_scope_##id(name);
+
+#endif //__TRACING_H__
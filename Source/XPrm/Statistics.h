@@ -1,6 +1,8 @@
 #ifndef	__STATISTICS_H__
 #define __STATISTICS_H__
 
+#include "../Util/Tracing.h"
+
 // Use to profile memory by start_timers
 #ifdef _DEBUG
 #define USE_TIMERS_TO_PROFILE_MEMORY 
@@ -56,10 +58,10 @@ int total_memory_used(); // count by pages, works under release and finale
 
 #define start_timer(title, group) 
 #define stop_timer(title, group) 
-#define start_timer_auto(title, group) 
+#define start_timer_auto(title, group) trace_scope_id(title##group, #title)
 #define create_timer(title, group) 
 #define start_created_timer(title, group) 
-#define start_autostop_timer(title, group) 
+#define start_autostop_timer(title, group) trace_scope_id(title##group, #title)
 #define statistics_add(title, group, x) 
 
 inline void profiler_start_stop(){}
@@ -163,10 +165,10 @@ public:
 	
 #define start_timer(title, group) static TimerData timer_##title##group(#title, group); timer_##title##group.start(); 
 #define stop_timer(title, group) timer_##title##group.stop();
-#define start_timer_auto(title, group) static TimerData timer_##title##group(#title, group); timer_##title##group.start(); AutoStopTimer autostop_timer_##title##group(timer_##title##group); 
+#define start_timer_auto(title, group) static TimerData timer_##title##group(#title, group); timer_##title##group.start(); AutoStopTimer autostop_timer_##title##group(timer_##title##group); trace_scope_id(title##group, #title)
 #define create_timer(title, group) static TimerData timer_##title##group(#title, group); 
 #define start_created_timer(title, group) timer_##title##group.start(); 
-#define start_autostop_timer(title, group) static TimerData timer_##title##group(#title, group); timer_##title##group.start(); AutoStopTimer autostop_timer_##title##group(timer_##title##group); 
+#define start_autostop_timer(title, group) static TimerData timer_##title##group(#title, group); timer_##title##group.start(); AutoStopTimer autostop_timer_##title##group(timer_##title##group); trace_scope_id(title##group, #title)
 #define statistics_add(title, group, x) { static StatisticalData timer_##title##group(#title, group); timer_##title##group.add(x); }
 
 inline void profiler_start_stop() { get_profiler().start_stop(); }
@@ -14,6 +14,11 @@
 #include <unordered_map>
 #include <cstring>
 #include <algorithm>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <set>
 #include "xerrhand.h"
 #include "xutl.h"
 #include "xstream.h"
@@ -34,6 +39,48 @@ filesystem_entries_map filesystem_entries;
 std::filesystem::path content_root_path = std::filesystem::path();
 std::string content_root_path_str;
 
+///Index of directory listings kept between starts
+
+static const uint32_t CONTENT_INDEX_MAGIC = 0x58494350; //"PCIX"
+static const uint32_t CONTENT_INDEX_VERSION = 1;
+
+//Listing done within this time after directory change is not trusted, mtime granularity may hide next change
+static const std::chrono::seconds CONTENT_INDEX_RACY_TIME(2);
+
+enum content_index_flags : uint8_t {
+    CONTENT_INDEX_FILE = 1 << 0,
+    CONTENT_INDEX_DIRECTORY = 1 << 1,
+    //Real directory, not a symlink, recursive_directory_iterator would descend into it
+    CONTENT_INDEX_RECURSE = 1 << 2
+};
+
+struct content_index_item {
+    std::string name;
+    uint8_t flags;
+};
+
+struct content_index_directory {
+    int64_t mtime = 0;
+    //When listing was done, same clock as mtime
+    int64_t listed = 0;
+    bool visited = false;
+    std::vector<content_index_item> items;
+};
+
+struct content_index {
+    std::string root;
+    std::unordered_map<std::string, content_index_directory> directories;
+    //Directories scanned in this session, not stored
+    std::set<std::string> scan_roots;
+    bool changed = false;
+};
+
+static content_index content_index_data;
+static std::string content_index_path;
+static bool content_index_trust = false;
+static bool content_index_loaded = false;
+static std::atomic<bool> content_index_saving(false);
+
 void filesystem_entry::set(filesystem_entry* entry) {
     if (entry == nullptr) return;
     this->key = entry->key;
@@ -265,13 +312,245 @@ const std::string& get_content_root_path_str() {
     return content_root_path_str;
 }
 
+static int64_t content_index_time(const std::filesystem::file_time_type& time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+///Returns directory listing from index if directory wasn't changed since, otherwise lists it from disk
+static const content_index_directory& content_index_list(content_index& index, const std::filesystem::path& dir, bool trust) {
+    std::string key = dir.u8string();
+    auto found = index.directories.find(key);
+    //Trusted listing is only good for first visit, later rescans are done to see changes made by game
+    if (trust && found != index.directories.end() && !found->second.visited) {
+        found->second.visited = true;
+        return found->second;
+    }
+    
+    //One stat per directory instead of one per entry
+    std::error_code error;
+    int64_t mtime = content_index_time(std::filesystem::last_write_time(dir, error));
+    if (error) {
+        mtime = 0;
+    }
+    if (found != index.directories.end() && mtime != 0 && found->second.mtime == mtime) {
+        int64_t racy = std::chrono::duration_cast<std::filesystem::file_time_type::duration>(CONTENT_INDEX_RACY_TIME).count();
+        if (mtime < found->second.listed - racy) {
+            found->second.visited = true;
+            return found->second;
+        }
+    }
+
+    content_index_directory& directory = index.directories[key];
+    directory.mtime = mtime;
+    directory.listed = content_index_time(std::filesystem::file_time_type::clock::now());
+    directory.visited = true;
+    directory.items.clear();
+    index.changed = true;
+
+    //Directory entries usually carry the type so no extra stat is needed, unreadable ones are skipped like before
+    std::filesystem::directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, error);
+    for (; !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        const std::filesystem::directory_entry& entry = *it;
+        std::error_code entry_error;
+        uint8_t flags = 0;
+        if (entry.is_regular_file(entry_error)) {
+            flags |= CONTENT_INDEX_FILE;
+        }
+        if (entry.is_directory(entry_error)) {
+            flags |= CONTENT_INDEX_DIRECTORY;
+            if (!entry.is_symlink(entry_error)) {
+                flags |= CONTENT_INDEX_RECURSE;
+            }
+        }
+        if (flags) {
+            directory.items.push_back({entry.path().filename().u8string(), flags});
+        }
+    }
+    return directory;
+}
+
+///Walks directory tree in same order as recursive_directory_iterator would do
+static void content_index_walk( // NOLINT(misc-no-recursion)
+        content_index& index,
+        const std::filesystem::path& dir,
+        bool trust,
+        const std::function<void(const std::filesystem::path&, bool)>& visit
+) {
+    const content_index_directory& directory = content_index_list(index, dir, trust);
+    for (const content_index_item& item : directory.items) {
+        std::filesystem::path path = dir / std::filesystem::u8path(item.name);
+        if (visit) {
+            visit(path, (item.flags & CONTENT_INDEX_DIRECTORY) != 0);
+        }
+        if (item.flags & CONTENT_INDEX_RECURSE) {
+            content_index_walk(index, path, trust, visit);
+        }
+    }
+}
+
+template<class T>
+static void content_index_write_value(std::ofstream& stream, const T& value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static void content_index_write_string(std::ofstream& stream, const std::string& value) {
+    uint32_t size = static_cast<uint32_t>(value.size());
+    content_index_write_value(stream, size);
+    stream.write(value.data(), size);
+}
+
+template<class T>
+static bool content_index_read_value(const std::string& data, size_t& offset, T& value) {
+    if (offset + sizeof(T) > data.size()) return false;
+    memcpy(&value, data.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+static bool content_index_read_string(const std::string& data, size_t& offset, std::string& value) {
+    uint32_t size;
+    if (!content_index_read_value(data, offset, size) || offset + size > data.size()) return false;
+    value.assign(data.data() + offset, size);
+    offset += size;
+    return true;
+}
+
+static bool content_index_load(content_index& index, const std::string& path) {
+    std::ifstream stream(std::filesystem::u8path(path), std::ios::binary);
+    if (!stream) return false;
+    std::string data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    size_t offset = 0;
+    uint32_t magic, version, directories;
+    if (!content_index_read_value(data, offset, magic) || magic != CONTENT_INDEX_MAGIC
+     || !content_index_read_value(data, offset, version) || version != CONTENT_INDEX_VERSION
+     || !content_index_read_string(data, offset, index.root)
+     || !content_index_read_value(data, offset, directories)) {
+        return false;
+    }
+    for (uint32_t i = 0; i < directories; ++i) {
+        std::string key;
+        content_index_directory directory;
+        uint32_t items;
+        if (!content_index_read_string(data, offset, key)
+         || !content_index_read_value(data, offset, directory.mtime)
+         || !content_index_read_value(data, offset, directory.listed)
+         || !content_index_read_value(data, offset, items)
+         || items > (data.size() - offset) / (sizeof(uint32_t) + sizeof(uint8_t))) {
+            return false;
+        }
+        directory.items.resize(items);
+        for (content_index_item& item : directory.items) {
+            if (!content_index_read_string(data, offset, item.name)
+             || !content_index_read_value(data, offset, item.flags)) {
+                return false;
+            }
+        }
+        index.directories[key] = std::move(directory);
+    }
+    return true;
+}
+
+static bool content_index_store(const content_index& index, const std::string& path) {
+    //Write aside and replace so interrupted write doesn't leave broken index
+    std::filesystem::path path_fs = std::filesystem::u8path(path);
+    std::filesystem::path path_tmp = std::filesystem::u8path(path + ".tmp");
+    {
+        std::ofstream stream(path_tmp, std::ios::binary | std::ios::trunc);
+        if (!stream) return false;
+        content_index_write_value(stream, CONTENT_INDEX_MAGIC);
+        content_index_write_value(stream, CONTENT_INDEX_VERSION);
+        content_index_write_string(stream, index.root);
+        uint32_t directories = 0;
+        for (const auto& entry : index.directories) {
+            if (entry.second.visited) directories++;
+        }
+        content_index_write_value(stream, directories);
+        for (const auto& entry : index.directories) {
+            //Directories not seen in this session belong to removed content
+            if (!entry.second.visited) continue;
+            content_index_write_string(stream, entry.first);
+            content_index_write_value(stream, entry.second.mtime);
+            content_index_write_value(stream, entry.second.listed);
+            content_index_write_value(stream, static_cast<uint32_t>(entry.second.items.size()));
+            for (const content_index_item& item : entry.second.items) {
+                content_index_write_string(stream, item.name);
+                content_index_write_value(stream, item.flags);
+            }
+        }
+        if (!stream) return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(path_tmp, path_fs, error);
+    return !error;
+}
+
+///Loads index for current content root on first use
+static bool content_index_prepare() {
+    if (content_index_path.empty()) {
+        return false;
+    }
+    if (!content_index_loaded) {
+        content_index_loaded = true;
+        if (!content_index_load(content_index_data, content_index_path)) {
+            content_index_data = content_index();
+        }
+    }
+    //Keys are relative to content root, index of other root is useless
+    if (content_index_data.root != content_root_path_str) {
+        content_index_data = content_index();
+        content_index_data.root = content_root_path_str;
+    }
+    return true;
+}
+
+void set_content_index(const std::string& path, bool trust_index) {
+    content_index_path = path;
+    content_index_trust = trust_index;
+    content_index_loaded = false;
+    content_index_data = content_index();
+}
+
+void save_content_index() {
+    if (content_index_path.empty() || !content_index_loaded || content_index_saving.exchange(true)) {
+        return;
+    }
+    if (!content_index_trust && !content_index_data.changed) {
+        content_index_saving = false;
+        return;
+    }
+    content_index_data.changed = false;
+
+    //Disk access is done aside, on slow disks this is what takes time
+    std::thread([index = content_index_data, path = content_index_path, trust = content_index_trust]() mutable {
+        if (trust) {
+            //Listings were used unchecked, validate them now so next start gets current ones
+            index.changed = false;
+            for (auto& entry : index.directories) {
+                entry.second.visited = false;
+            }
+            for (const std::string& root : index.scan_roots) {
+                content_index_walk(index, std::filesystem::u8path(root), false, nullptr);
+            }
+            if (index.changed) {
+                printf("Content changed since index was stored, changes will be visible on next start\n");
+            }
+        }
+        if (!content_index_store(index, path)) {
+            fprintf(stderr, "Couldn't store content index at %s\n", path.c_str());
+        }
+        content_index_saving = false;
+    }).detach();
+}
+
 ///Adds a new filesystem entry
 filesystem_entry* add_filesystem_entry_internal( // NOLINT(misc-no-recursion)
         filesystem_entries_map& paths,
         std::string path_content,
         const std::string& destination_path,
         const std::string& source_path,
-        const filesystem_scan_options& options
+        const filesystem_scan_options& options,
+        int is_directory_hint = -1
 ) {
     //Remove ./ from res path since it can mess with some code dealing with extensions
     //Remove root since working directory is already there
@@ -296,7 +575,10 @@ filesystem_entry* add_filesystem_entry_internal( // NOLINT(misc-no-recursion)
         || startsWith(entry_key, "crashdata")
         || endsWith(entry_key, ".ini")) {
         
-        bool path_is_directory = std::filesystem::is_directory(std::filesystem::u8path(path_content));
+        //Scanners already know the type, only ask filesystem when unknown
+        bool path_is_directory = is_directory_hint < 0
+                ? std::filesystem::is_directory(std::filesystem::u8path(path_content))
+                : is_directory_hint != 0;
 
         //Create absolute path too
         std::string entry_key_content = convert_path_native(path_content);
@@ -362,7 +644,7 @@ filesystem_entry* add_filesystem_entry_internal( // NOLINT(misc-no-recursion)
                 terminate_with_char(destination_path_copy, PATH_SEP);
                 terminate_with_char(source_path_copy, PATH_SEP);
             }
-            add_filesystem_entry_internal(paths, path_content, destination_path_copy, source_path_copy, options);
+            add_filesystem_entry_internal(paths, path_content, destination_path_copy, source_path_copy, options, true);
         }
 
         return entry.get();
@@ -447,10 +729,17 @@ bool scan_resource_paths(std::string destination_path, std::string source_path,
         add_filesystem_entry_internal(paths, source_path, destination_path, source_path, scanOptions);
     }
 
-    //Do recursive search on source path
-    for (const auto& entry : std::filesystem::recursive_directory_iterator(source_dir, std::filesystem::directory_options::skip_permission_denied)) {
-        if (entry.is_regular_file() || entry.is_directory()) {
-            add_filesystem_entry_internal(paths, entry.path().u8string(), destination_path, source_path, scanOptions);
+    //Do recursive search on source path, unchanged directories are taken from index
+    if (content_index_prepare()) {
+        content_index_data.scan_roots.insert(source_dir.u8string());
+        content_index_walk(content_index_data, source_dir, content_index_trust, [&](const std::filesystem::path& path, bool is_directory) {
+            add_filesystem_entry_internal(paths, path.u8string(), destination_path, source_path, scanOptions, is_directory);
+        });
+    } else {
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(source_dir, std::filesystem::directory_options::skip_permission_denied)) {
+            if (entry.is_regular_file() || entry.is_directory()) {
+                add_filesystem_entry_internal(paths, entry.path().u8string(), destination_path, source_path, scanOptions, entry.is_directory());
+            }
         }
     }
 
@@ -11,7 +11,11 @@
  * that are case sensitive such as ones Linux uses usually. As fixing the entire codebase and correct paths incoming
  * from models and scripts would be too costly, this solution was more reasonable to implement only at a cost of
  * a possible path lookup overhead (optimizations may be possible, currently is a big hash map) and the initial
- * scanning of dirs required when starting up (a cache system or bg scanning may be implemented to speedup).
+ * scanning of dirs required when starting up.
+ * 
+ * To speedup the scanning the directory listings can be kept in an index file between starts, a directory is only
+ * listed again if its modification time changed, so unchanged install costs one stat per directory instead of
+ * listing every file. Mods and other mapped paths use the same index since they are scanned the same way.
  * 
  * An initially unintended feature of this system is the possibility of overlay-ing parts of directory tree
  * and the possibility of supporting addons that "add" files to game without altering the real dirs structure.
@@ -130,6 +134,13 @@ const std::string& get_content_root_path_str();
 //Removes the source path in each scanned path before saving to internal resource path list to destination path
 bool scan_resource_paths(std::string destination_path = "", std::string source_path = "", const filesystem_scan_options* options = nullptr);
 
+//Sets file where directory listings are kept between starts, empty path disables it
+//If trust_index is set the stored listings are used unchecked and validated in background by save_content_index
+void set_content_index(const std::string& path, bool trust_index = false);
+
+//Stores directory listings gathered by scans into index file, writing is done in background
+void save_content_index();
+
 //Usual POSIX open but with path conversion
 int file_open(const char* path, int oflags, int sflags = 0);
 
@@ -0,0 +1,34 @@
+#ifndef PERIMETER_MAPPED_FILE_H
+#define PERIMETER_MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Whole file mapped into memory with copy-on-write: pages are read from file only when touched and
+ * any write goes into a private copy of that page, the file itself is never modified.
+ * Used for big data that is mostly read (world layers), so loading doesn't need to copy it into heap.
+ */
+class mapped_file {
+public:
+    mapped_file() = default;
+    ~mapped_file();
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    //Maps the file at OS path (already converted by convert_path_content), returns false if can't be mapped
+    bool open(const std::string& path);
+    void close();
+
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* mapping_ = nullptr;
+#endif
+};
+
+#endif //PERIMETER_MAPPED_FILE_H
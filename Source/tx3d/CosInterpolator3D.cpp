@@ -18,21 +18,22 @@ const string CosInterpolator3D::TYPE_NAME = "Cosine";
 
 float CosInterpolator3D::interpolate(const Vector3D &v) {
 	//TODO: optimization needed
-	xi = xm::floor(v.x);
-	yi = xm::floor(v.y);
-	zi = xm::floor(v.z);
-	xd = v.x - xi;
-	yd = v.y - yi;
-	zd = v.z - zi;
+	//Interpolator3DFactory returns shared instances - no scratch in members
+	int xi = xm::floor(v.x);
+	int yi = xm::floor(v.y);
+	int zi = xm::floor(v.z);
+	float xd = v.x - xi;
+	float yd = v.y - yi;
+	float zd = v.z - zi;
 
-	vert1 = getNoise(xi, yi, zi);
-	vert2 = getNoise(xi + 1, yi, zi);
-	vert3 = getNoise(xi, yi + 1, zi);
-	vert4 = getNoise(xi + 1, yi + 1, zi);
-	vert5 = getNoise(xi, yi, zi + 1);
-	vert6 = getNoise(xi + 1, yi, zi + 1);
-	vert7 = getNoise(xi, yi + 1, zi + 1);
-	vert8 = getNoise(xi + 1, yi + 1, zi + 1);
+	float vert1 = getNoise(xi, yi, zi);
+	float vert2 = getNoise(xi + 1, yi, zi);
+	float vert3 = getNoise(xi, yi + 1, zi);
+	float vert4 = getNoise(xi + 1, yi + 1, zi);
+	float vert5 = getNoise(xi, yi, zi + 1);
+	float vert6 = getNoise(xi + 1, yi, zi + 1);
+	float vert7 = getNoise(xi, yi + 1, zi + 1);
+	float vert8 = getNoise(xi + 1, yi + 1, zi + 1);
 
 	return 
 		cosInterpolate(
@@ -97,7 +98,7 @@ float CosInterpolator3D::interpolate(const Vector3D &v) {
 }
 
 float CosInterpolator3D::cosInterpolate(float h1, float h2, float shift) {
-	coss = (1.0 - xm::cos(shift * 3.1415926)) * 0.5;
+	float coss = (1.0 - xm::cos(shift * 3.1415926)) * 0.5;
 	return h1 * (1.0 - coss) + h2 * coss;
 }
 
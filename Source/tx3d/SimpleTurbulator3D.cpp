@@ -18,7 +18,8 @@ std::unique_ptr<SimpleTurbulator3D> SimpleTurbulator3D::sharedInstance;
 float SimpleTurbulator3D::turbulate3D(const Vector3D &v, float persistence, int octaveCount, Interpolator3D *interpolator) {
 	float sum = 0.0;
 	float ampl = 1.0;
-	freqV = v;
+	//Экземпляр общий для всех текстур - без состояния, чтобы считать из нескольких потоков
+	Vector3D freqV = v;
 	for (int i = 0; i < octaveCount; i++) {
 		sum += interpolator->interpolate(freqV) * ampl;
 		freqV *= 2.0;
@@ -32,7 +32,6 @@ namespace tx3d {
 
 		protected:
 			static std::unique_ptr<SimpleTurbulator3D> sharedInstance;
-			Vector3D freqV;
 	};
 
 }
@@ -77,9 +77,8 @@ float SphericSimplexInterpolator3D::interpolate(const Vector3D &v) {
 	float reminderY = v.y + skewLength;
 	float reminderZ = v.z + skewLength;
 */
-	simplex[0] = 0;
-	simplex[1] = 0;
-	simplex[2] = 0;
+	//Interpolator3DFactory returns shared instances - no scratch in members
+	char simplex[3] = { 0, 0, 0 };
 
 	int8_t highIndex;
 	int8_t lowIndex;